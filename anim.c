@@ -0,0 +1,147 @@
+#include "anim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const anim_table_t anim_builtin = {
+	.frame_w = ANIM_FRAME_W,
+	.frame_h = ANIM_FRAME_H,
+	.columns = ANIM_COLUMNS,
+	.rows = ANIM_ROWS,
+	.clips = {
+#define ANIM_CLIP_TABLE(id, name, duration, ...) \
+		[id] = { \
+			.frame_count = sizeof((SDL_Rect[]){__VA_ARGS__}) / sizeof(SDL_Rect), \
+			.frame_duration = (duration), \
+			.frames = {__VA_ARGS__}, \
+		},
+		ANIM_CLIPS(ANIM_CLIP_TABLE)
+#undef ANIM_CLIP_TABLE
+	},
+};
+
+static const char *const clip_names[CLIP_COUNT] = {
+#define ANIM_CLIP_NAME(id, name, duration, ...) [id] = name,
+	ANIM_CLIPS(ANIM_CLIP_NAME)
+#undef ANIM_CLIP_NAME
+};
+
+anim_clip_id_t anim_clip_by_name(const char *name) {
+	for (int i = 0; i < CLIP_COUNT; ++i)
+		if (strcmp(clip_names[i], name) == 0)
+			return (anim_clip_id_t)i;
+	return CLIP_COUNT;
+}
+
+const char *anim_clip_name(anim_clip_id_t clip) {
+	return clip < CLIP_COUNT ? clip_names[clip] : "unknown";
+}
+
+void anim_timer_play(anim_timer_t *timer, const anim_clip_t *clip) {
+	timer->duration = clip->frame_duration;
+	timer->frame_count = clip->frame_count;
+	timer->frame %= clip->frame_count;
+}
+
+void anim_step(anim_timer_t *timers, int count, float dt) {
+	// No branch, a long frame skips as many frames as its time covers
+	for (int i = 0; i < count; ++i) {
+		float elapsed = timers[i].elapsed + dt;
+		int steps = (int)(elapsed / timers[i].duration);
+		timers[i].elapsed = elapsed - (float)steps * timers[i].duration;
+		timers[i].frame = (timers[i].frame + steps) % timers[i].frame_count;
+	}
+}
+
+// Parses "row:column", or "row:*" for the whole row, appending frames to the clip
+static bool parse_frames(const anim_table_t *table, anim_clip_t *clip, const char *token) {
+	int row, column;
+	char rest;
+	int first = 0, last = table->columns - 1;
+
+	if (sscanf(token, "%d:%d%c", &row, &column, &rest) == 2)
+		first = last = column;
+	else if (sscanf(token, "%d:*%c", &row, &rest) != 1)
+		return false;
+	if (row < 0 || row >= table->rows || first < 0 || last >= table->columns)
+		return false;
+
+	for (column = first; column <= last; ++column) {
+		if (clip->frame_count == ANIM_MAX_FRAMES)
+			return false;
+		clip->frames[clip->frame_count++] = (SDL_Rect){column * table->frame_w, row * table->frame_h, table->frame_w, table->frame_h};
+	}
+	return true;
+}
+
+static bool parse_line(anim_table_t *table, char *line) {
+	char *keyword = strtok(line, " \t\r\n");
+	if (!keyword || keyword[0] == '#')
+		return true;
+
+	if (strcmp(keyword, "frame") == 0) {
+		const char *w = strtok(NULL, " \t\r\n"), *h = strtok(NULL, " \t\r\n");
+		if (!w || !h)
+			return false;
+		table->frame_w = atoi(w);
+		table->frame_h = atoi(h);
+		return table->frame_w > 0 && table->frame_h > 0;
+	}
+	if (strcmp(keyword, "grid") == 0) {
+		const char *columns = strtok(NULL, " \t\r\n"), *rows = strtok(NULL, " \t\r\n");
+		if (!columns || !rows)
+			return false;
+		table->columns = atoi(columns);
+		table->rows = atoi(rows);
+		return table->columns > 0 && table->rows > 0;
+	}
+	if (strcmp(keyword, "clip") == 0) {
+		const char *name = strtok(NULL, " \t\r\n"), *duration = strtok(NULL, " \t\r\n");
+		anim_clip_id_t id = name ? anim_clip_by_name(name) : CLIP_COUNT;
+		if (id == CLIP_COUNT || !duration || table->frame_w <= 0 || table->columns <= 0)
+			return false;
+
+		anim_clip_t *clip = &table->clips[id];
+		*clip = (anim_clip_t){.frame_duration = (float)atof(duration)};
+		for (char *token; (token = strtok(NULL, " \t\r\n")); )
+			if (!parse_frames(table, clip, token))
+				return false;
+		return clip->frame_count > 0 && clip->frame_duration > 0;
+	}
+	return false;
+}
+
+bool anim_table_load(anim_table_t *table, const char *path) {
+	size_t size;
+	char *text = SDL_LoadFile(path, &size);
+	if (!text) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read animation table %s: %s\n", path, SDL_GetError());
+		return false;
+	}
+
+	*table = (anim_table_t){0};
+	bool ok = true;
+	int number = 1;
+	for (char *line = text, *next; line && ok; line = next, ++number) {
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		ok = parse_line(table, line);
+	}
+	SDL_free(text);
+
+	if (!ok) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Invalid animation table %s at line %d\n", path, number - 1);
+		return false;
+	}
+
+	// Actors may enter any state, every clip is needed
+	for (int i = 0; i < CLIP_COUNT; ++i) {
+		if (table->clips[i].frame_count == 0) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Animation table %s has no %s clip\n", path, clip_names[i]);
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,74 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+#define ANIM_MAX_FRAMES 16
+#define ANIM_NAME_SIZE 24
+
+// Built-in layout of the animal sheets: 4x13 frames of 32x32
+#define ANIM_FRAME_W 32
+#define ANIM_FRAME_H 32
+#define ANIM_COLUMNS 4
+#define ANIM_ROWS 13
+
+// One frame of the built-in grid
+#define ANIM_CELL(row, column) {(column) * ANIM_FRAME_W, (row) * ANIM_FRAME_H, ANIM_FRAME_W, ANIM_FRAME_H}
+#define ANIM_ROW(row) ANIM_CELL(row, 0), ANIM_CELL(row, 1), ANIM_CELL(row, 2), ANIM_CELL(row, 3)
+
+// Every clip an actor can play: id, name in metadata, frame duration, frames
+#define ANIM_CLIPS(X) \
+	X(CLIP_IDLE_DOWN,	"idle-down",	0.20f,	ANIM_ROW(0)) \
+	X(CLIP_IDLE_RIGHT,	"idle-right",	0.20f,	ANIM_ROW(1)) \
+	X(CLIP_IDLE_LEFT,	"idle-left",	0.20f,	ANIM_ROW(2)) \
+	X(CLIP_IDLE_UP,		"idle-up",		0.20f,	ANIM_ROW(3)) \
+	X(CLIP_WALK_DOWN,	"walk-down",	0.20f,	ANIM_ROW(5), ANIM_ROW(6)) \
+	X(CLIP_WALK_LEFT,	"walk-left",	0.20f,	ANIM_ROW(7), ANIM_ROW(8)) \
+	X(CLIP_WALK_RIGHT,	"walk-right",	0.20f,	ANIM_ROW(9), ANIM_ROW(10)) \
+	X(CLIP_WALK_UP,		"walk-up",		0.20f,	ANIM_ROW(11), ANIM_ROW(12))
+
+typedef enum {
+#define ANIM_CLIP_ID(id, name, duration, ...) id,
+	ANIM_CLIPS(ANIM_CLIP_ID)
+#undef ANIM_CLIP_ID
+	CLIP_COUNT,
+} anim_clip_id_t;
+
+typedef struct {
+	int frame_count;
+	float frame_duration;				// Seconds each frame stays on screen
+	SDL_Rect frames[ANIM_MAX_FRAMES];	// Source rect of every frame, relative to the sheet
+} anim_clip_t;
+
+// Clips of one sheet layout
+typedef struct {
+	int frame_w, frame_h;				// Untrimmed size of one frame
+	int columns, rows;					// Frame grid of the sheet
+	anim_clip_t clips[CLIP_COUNT];
+} anim_table_t;
+
+// Clock of the clip an actor plays, apart from the other animation fields so the stepper reads nothing else
+typedef struct {
+	float elapsed;						// Seconds spent on the current frame
+	float duration;						// Seconds per frame of the clip
+	int frame;							// Frame of the clip on screen
+	int frame_count;
+} anim_timer_t;
+
+// Table of the built-in sheets, generated at compile time
+extern const anim_table_t anim_builtin;
+
+// Loads a table from a metadata file, see player/animals.anim
+bool anim_table_load(anim_table_t *table, const char *path);
+
+anim_clip_id_t anim_clip_by_name(const char *name);
+const char *anim_clip_name(anim_clip_id_t clip);
+
+// Switches a timer to another clip, staying on the same frame when the clip has it
+void anim_timer_play(anim_timer_t *timer, const anim_clip_t *clip);
+// Advances count timers by dt, each by as many frames as its own clip allows
+void anim_step(anim_timer_t *timers, int count, float dt);
+
+#endif // ANIM_H
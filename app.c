@@ -5,44 +5,129 @@
 #include <SDL.h>
 #include <SDL_image.h>
 
+#include "anim.h"
+#include "asset_loader.h"
+#include "atlas.h"
+#include "atlas_pages.h"
+#include "camera.h"
+#include "components.h"
+#include "dirty_rects.h"
+#include "ecs.h"
+#include "hot_reload.h"
+#include "integrate.h"
+#include "job.h"
+#include "registry.h"
+#include "render_queue.h"
+#include "soft_render.h"
+#include "spatial_grid.h"
+#include "sprite_batch.h"
+#include "spritepack.h"
+#include "sweep.h"
+#include "texture_cache.h"
+
 #define FPS 165
+#define STEP_RATE 120					// Simulation steps per second, whatever the display rate
+#define MAX_FRAME_TIME 0.25f			// Longer frames are cut short, so a stall never needs more steps than it can run
 #define WINDOW_WIDTH 2560
 #define WINDOW_HEIGHT 1440
+#define TEXTURE_BUDGET_MB 256
+#define CULL_MARGIN 16.0f				// World pixels around the view, actors are drawn up to a step behind where they are culled
+#define ZOOM_STEP 1.25f
+#define UPLOAD_BUDGET_MS 2.0f			// Time per frame spent uploading decoded assets
+#define SPRITE_PACK "player/player.spk"	// Built by `make pack`, PNG sheets are used without it
+#define MANIFEST "player/animals.manifest"
+#define ASSET_DIR "player"
+#define FLEE_RADIUS 96.0f				// World pixels around the player, wanderers heading closer turn back
+#define FLEE_MAX 64						// Wanderers turned back per step
+#define LIFE_MIN 20.0f					// Seconds a wanderer stays before another one takes its place
+#define LIFE_MAX 60.0f
 
-typedef enum {
-	MOVING_DOWN,
-	MOVING_RIGHT,
-	MOVING_LEFT,
-	MOVING_UP,
-	IDLE,
-} actor_state_t;
+// Clip played in each state, idle clips are picked by the direction the actor faces
+static const anim_clip_id_t walk_clips[IDLE] = {
+	[MOVING_DOWN]	= CLIP_WALK_DOWN,
+	[MOVING_RIGHT]	= CLIP_WALK_RIGHT,
+	[MOVING_LEFT]	= CLIP_WALK_LEFT,
+	[MOVING_UP]		= CLIP_WALK_UP,
+};
+static const anim_clip_id_t idle_clips[IDLE] = {
+	[MOVING_DOWN]	= CLIP_IDLE_DOWN,
+	[MOVING_RIGHT]	= CLIP_IDLE_RIGHT,
+	[MOVING_LEFT]	= CLIP_IDLE_LEFT,
+	[MOVING_UP]		= CLIP_IDLE_UP,
+};
 
-typedef struct {
-	actor_state_t state;
-	int animation_key;
-	SDL_Texture *texture;				// Driver-specific representation of pixel data
-	SDL_Rect src_rect;					// To load texture and display animation
-	SDL_Rect dest_rect;					// To scale and change position
-	float speed;						// Actor speed
-	int frame_widht, texture_width;		// Texture width/height is used to store width/height of the original sprite image with animation
-	int frame_height, texture_height;	// Frame width/height is used to store widht/height of one single sprite in the texture image
-} actor_t;
+// Size of every component, indexed by id
+static const size_t component_sizes[COMPONENT_COUNT] = {
+#define COMPONENT_SIZE(id, type) [id] = sizeof(type),
+	COMPONENTS(COMPONENT_SIZE)
+#undef COMPONENT_SIZE
+};
 
-typedef enum {
-	CAT_GRAY,
-	CAT_ORANGE,
-	FOX,
-	BIRD_BLUE,
-	BIRD_WHITE,
-	RACOON,
-} animal_t;
+// What the proximity and collision passes read of an actor, gathered once per step
+typedef struct {
+	position_t *position;				// In its chunk, actors only come and go between steps
+	const position_t *previous;
+	velocity_t *velocity;
+	const bounce_t *bounce;
+	float x, y;							// Centre
+	const collision_mask_t *mask;		// Of its species
+	int frame;							// Frame of the mask being drawn
+	int left, top;						// World pixel of the mask's top left corner
+} body_t;
 
 typedef struct {
-	animal_t animal;
-	actor_t **actors;					// Dynamic array of pointers to actors
-	int actor_count;					// Number of actors in the game
+	int species;						// Species of the player
+	ecs_entity_t player;				// Stays valid while other actors come and go
+	ecs_world_t world;					// Every actor of the game, grouped by components
+	body_t *bodies;						// Every actor in chunk order, grid and sweep ids index them
+	int body_count, body_capacity;
+	int player_body;					// Body of the player
+	spatial_grid_t grid;				// Centre of every body, for proximity queries; rebuilt every step
+	sweep_t sweep;						// Bodies whose sprite rects overlap, found every step
 } game_t;
 
+struct app;
+typedef void (*chunk_fn)(struct app *app, const ecs_query_t *chunk, ecs_commands_t *commands);
+
+// One pass over the chunks holding some components
+typedef struct {
+	ecs_mask_t mask;
+	chunk_fn fn;
+	struct app *app;
+	ecs_query_t *chunks;				// Gathered every step, one job each
+	ecs_commands_t *commands;			// Structural changes of each chunk, applied in chunk order after the step
+	job_t *jobs;
+	int count, capacity;
+	job_counter_t done;
+} system_t;
+
+// Systems of a step in order: id, components, chunk function
+#define SYSTEMS(X) \
+	X(SYSTEM_SNAPSHOT,	ECS_COMPONENT(COMPONENT_POSITION) | ECS_COMPONENT(COMPONENT_PREVIOUS), \
+						snapshot_chunk) \
+	X(SYSTEM_MOVE,		ECS_COMPONENT(COMPONENT_POSITION) | ECS_COMPONENT(COMPONENT_VELOCITY) | ECS_COMPONENT(COMPONENT_EXTENT) | \
+						ECS_COMPONENT(COMPONENT_BOUNCE), move_chunk) \
+	X(SYSTEM_STATE,		ECS_COMPONENT(COMPONENT_VELOCITY) | ECS_COMPONENT(COMPONENT_ANIMATION), \
+						state_chunk) \
+	X(SYSTEM_CLIP,		ECS_COMPONENT(COMPONENT_ANIMATION) | ECS_COMPONENT(COMPONENT_TIMER) | ECS_COMPONENT(COMPONENT_SPRITE), \
+						clip_chunk) \
+	X(SYSTEM_ANIMATION,	ECS_COMPONENT(COMPONENT_ANIMATION) | ECS_COMPONENT(COMPONENT_TIMER) | ECS_COMPONENT(COMPONENT_SOURCE) | \
+						ECS_COMPONENT(COMPONENT_SPRITE), animation_chunk) \
+	X(SYSTEM_LIFE,		WANDERER_MASK, life_chunk)
+
+typedef enum {
+#define SYSTEM_ID(id, mask, fn) id,
+	SYSTEMS(SYSTEM_ID)
+#undef SYSTEM_ID
+	SYSTEM_COUNT,
+} system_id_t;
+
+// Render queue layers, drawn in this order
+typedef enum {
+	LAYER_GROUND,
+	LAYER_ACTORS,
+} layer_t;
+
 // Application state
 typedef enum {
 	QUIT,
@@ -51,21 +136,42 @@ typedef enum {
 } app_state_t;
 
 // Application type struct
-typedef struct {
+typedef struct app {
 	// Configuration
 	app_state_t state;
 	SDL_Window *window;				// The opaque type used to identify a window
 	SDL_Renderer *renderer;			// A structure representing rendering state
-	actor_t actor;
+	render_queue_t queue;			// Sprites of the frame, sorted by layer, texture and depth
+	sprite_batch_t batch;			// Sprites of the frame, drawn once per texture
+	bool dirty_mode;				// Software renderer redrawing only what changed into the window surface
+	dirty_rects_t dirty;
+	bool soft_mode;					// Sprites drawn on the CPU into a streaming texture by the job threads
+	soft_render_t soft;
+	bool vsync;						// SDL_RenderPresent waits for the display, the frame needs no other pacing
+	bool redraw;					// Changed pixels no sprite shows, the next frame is redrawn whole
+	asset_loader_t loader;			// Decodes assets off the render thread
+	hot_reload_t watcher;			// Edited sheets, reloaded while the game runs
+	texture_cache_t textures;		// Every texture of the game, shared through reference counts
+	int placeholder;				// Texture drawn in place of the ones still loading
+	registry_t registry;			// Every species of the manifest
+	atlas_t atlas;					// Sheets of the sprite pack, uploaded once at startup
+	atlas_pages_t pages;			// Sheets missing from the pack, loaded on first use into shared pages
+	integrate_fn integrate;			// Movement kernel of the CPU
+	float limit[2];					// World size, actors stay inside
+	camera_t camera;				// Part of the world drawn, follows the player
+	camera_cull_fn cull;			// Visibility kernel of the CPU
+	job_system_t jobs;				// Runs the systems on every core
+	system_t systems[SYSTEM_COUNT];
 
 	// Game state
 	game_t game;
 
 	// Timers/Controls
-	float frame_time;
-	int prev_time;
-	int current_time;
-	float delta_time;
+	uint64_t prev_counter;
+	uint64_t current_counter;
+	float delta_time;				// Seconds per simulation step
+	float accumulator;				// Seconds not simulated yet, less than a step after the steps of a frame
+	float alpha;					// Fraction of a step between the last two positions drawn
 	const uint8_t *key_state;
 } app_t;
 
@@ -74,7 +180,15 @@ typedef struct {
 	const char *title;
 	uint32_t window_width;
 	uint32_t window_height;
+	uint32_t world_width;			// Size of the world actors walk in, the window shows part of it
+	uint32_t world_height;
 	uint32_t flags, renderer_flags;
+	size_t texture_budget;			// Bytes of graphics memory kept for unused textures
+	int actor_count;				// Wandering actors spawned besides the player
+	int threads;					// Job threads besides the main one
+	int bench_count;				// Actors of the integration benchmark, runs it instead of the game when set
+	bool dirty_rects;				// Redraws and pushes only the changed parts of the window, on the CPU
+	bool soft_render;				// Draws sprites with the SIMD blitter instead of the renderer
 } config_t;
 
 
@@ -92,18 +206,73 @@ bool init_app(app_t *app, const config_t config) {
 		return false;
 	}
 
-	app->renderer = SDL_CreateRenderer(app->window, -1, config.renderer_flags);
+	// The software renderer draws into the window surface, which keeps the last frame between updates
+	// The CPU blitter only needs a renderer to show its frame, whichever the machine has, still paced by vsync
+	app->dirty_mode = config.dirty_rects;
+	app->soft_mode = config.soft_render && !config.dirty_rects;
+	if (config.soft_render && config.dirty_rects)
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "--soft-render is ignored with --dirty-rects\n");
+	app->renderer = SDL_CreateRenderer(app->window, -1, app->dirty_mode ? SDL_RENDERER_SOFTWARE : app->soft_mode ? config.renderer_flags & SDL_RENDERER_PRESENTVSYNC : config.renderer_flags);
 	if (!app->renderer) {
 		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create renderer: %s\n", SDL_GetError());
 		return false;
 	}
+	SDL_RendererInfo info;
+	app->vsync = SDL_GetRendererInfo(app->renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+
+	texture_cache_init(&app->textures, app->renderer, config.texture_budget);
+	if (!render_queue_init(&app->queue)) return false;
+	if (!sprite_batch_init(&app->batch, app->renderer)) return false;
+	if (!dirty_rects_init(&app->dirty)) return false;
+	if (!soft_render_init(&app->soft, &app->textures)) return false;
+	if (app->soft_mode)
+		SDL_Log("Software blitter: %s\n", soft_span_name(app->soft.span));
+	if (!asset_loader_init(&app->loader, SDL_GetCPUCount() - 1)) return false;
+	if (!hot_reload_init(&app->watcher, ASSET_DIR)) return false;
+
+	// Translucent square, made without I/O so it is ready from the first frame
+	const uint32_t placeholder_pixel = 0x60FFFFFF;
+	app->placeholder = texture_cache_acquire(&app->textures, "placeholder");
+	if (app->placeholder == TEXTURE_NONE) {
+		SDL_Texture *placeholder = SDL_CreateTexture(app->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 1, 1);
+		if (!placeholder || SDL_UpdateTexture(placeholder, NULL, &placeholder_pixel, sizeof(placeholder_pixel)) != 0) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create placeholder texture: %s\n", SDL_GetError());
+			return false;
+		}
+		SDL_SetTextureBlendMode(placeholder, SDL_BLENDMODE_BLEND);
+		app->placeholder = texture_cache_insert(&app->textures, "placeholder", placeholder);
+		if (app->placeholder == TEXTURE_NONE) {
+			SDL_DestroyTexture(placeholder);
+			return false;
+		}
+	}
+	if (app->soft_mode) {
+		SDL_Surface *pixel = SDL_CreateRGBSurfaceWithFormatFrom((void *)&placeholder_pixel, 1, 1, 32, sizeof(placeholder_pixel), SDL_PIXELFORMAT_ARGB8888);
+		if (!pixel || !soft_render_upload(&app->soft, app->placeholder, 0, 0, pixel)) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not copy placeholder for the software blitter: %s\n", SDL_GetError());
+			return false;
+		}
+		SDL_FreeSurface(pixel);
+	}
+	if (!atlas_pages_init(&app->pages, &app->textures, ATLAS_PAGE_SIZE)) return false;
+
+	app->integrate = integrate_select();
+	SDL_Log("Movement kernel: %s\n", integrate_name(app->integrate));
+	app->limit[0] = (float)config.world_width;
+	app->limit[1] = (float)config.world_height;
+	camera_init(&app->camera, app->limit[0], app->limit[1], (float)config.window_width, (float)config.window_height);
+	app->cull = camera_cull_select();
+	SDL_Log("Culling kernel: %s\n", camera_cull_name(app->cull));
+
+	if (!job_system_init(&app->jobs, config.threads)) return false;
 
 	// If everything is OK set state to RUNNING
 	app->state = RUNNING;
-	app->frame_time = 0;
-	app->prev_time = 0;
-	app->current_time = 0;
-	app->delta_time = 0;
+	app->current_counter = SDL_GetPerformanceCounter();
+	app->prev_counter = app->current_counter;
+	app->delta_time = 1.0f / STEP_RATE;
+	app->accumulator = 0;
+	app->alpha = 0;
 
 	return true;
 }
@@ -117,121 +286,587 @@ bool set_config(config_t *config, int argc, char *argv[]) {
 		.window_height 	= WINDOW_HEIGHT,
 		.flags 			= SDL_WINDOW_RESIZABLE,
 		.renderer_flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC,
+		.texture_budget = (size_t)TEXTURE_BUDGET_MB * 1024 * 1024,
+		.threads		= SDL_GetCPUCount() - 1,
 	};
 
 	// Override defaults
-	for (int i = 1; i < argc; ++i)
-		(void)argv[i];	// Unused variables
+	for (int i = 1; i < argc; ++i) {
+		unsigned long megabytes;
+		int count;
+		unsigned width, height;
+		if (sscanf(argv[i], "--texture-budget=%lu", &megabytes) == 1)
+			config->texture_budget = (size_t)megabytes * 1024 * 1024;
+		else if (sscanf(argv[i], "--actors=%d", &count) == 1 && count >= 0)
+			config->actor_count = count;
+		else if (sscanf(argv[i], "--threads=%d", &count) == 1 && count >= 0)
+			config->threads = count;
+		else if (sscanf(argv[i], "--bench-integrate=%d", &count) == 1 && count > 0)
+			config->bench_count = count;
+		else if (SDL_strcmp(argv[i], "--dirty-rects") == 0)
+			config->dirty_rects = true;
+		else if (SDL_strcmp(argv[i], "--soft-render") == 0)
+			config->soft_render = true;
+		else if (sscanf(argv[i], "--world=%ux%u", &width, &height) == 2 && width > 0 && height > 0) {
+			config->world_width = width;
+			config->world_height = height;
+		}
+		else
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown option: %s\n", argv[i]);
+	}
+	// The world is the window unless it is set
+	if (!config->world_width) {
+		config->world_width = config->window_width;
+		config->world_height = config->window_height;
+	}
 
 	return true;
 }
 
-// Handles movement without delays
-void handle_continuous_input(app_t *app, actor_t *actor, config_t config) {
+// Xorshift, every wanderer keeps its own state so chunks on other threads draw their own numbers
+static uint32_t next_random(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+// In [0, 1)
+static float random_unit(uint32_t *state) {
+	return (float)(next_random(state) >> 8) / 16777216.0f;
+}
+
+// Half the speed of a species along one of the four directions
+static velocity_t wander_velocity(float speed, uint32_t *state) {
+	speed *= 0.5f;
+	int direction = (int)(next_random(state) % 4);
+	return (velocity_t){direction == 0 ? speed : direction == 1 ? -speed : 0, direction == 2 ? speed : direction == 3 ? -speed : 0};
+}
+
+// Switches clip, staying on the same frame so walking picks up where idling left off
+void play_clip(animation_t *animation, anim_timer_t *timer, const anim_table_t *anims, anim_clip_id_t clip) {
+	if (animation->clip == clip)
+		return;
+	animation->clip = clip;
+	anim_timer_play(timer, &anims->clips[clip]);
+}
+
+// Handles movement without delays, only the velocity of the player is set here
+void handle_continuous_input(app_t *app) {
+	velocity_t *velocity = ecs_get(&app->game.world, app->game.player, COMPONENT_VELOCITY);
+	const sprite_t *sprite = ecs_get(&app->game.world, app->game.player, COMPONENT_SPRITE);
+	float speed = registry_get(&app->registry, sprite->species)->speed;
 
 	app->key_state = SDL_GetKeyboardState(NULL);
 
-	if (app->key_state[SDL_SCANCODE_RIGHT]) {
-		actor->dest_rect.x += actor->speed * app->delta_time;
-		// Animation moving right
-		actor->src_rect.y = actor->frame_height * (actor->animation_key + 9);
-		actor->state = MOVING_RIGHT;
-		// Right boundary
-		if (actor->dest_rect.x + actor->dest_rect.w > (int)config.window_width)
-            actor->dest_rect.x = config.window_width - actor->dest_rect.w;  
-	}
-	else if (app->key_state[SDL_SCANCODE_LEFT]) {
-		actor->dest_rect.x -= actor->speed * app->delta_time;
-		// Animation moving left
-		actor->src_rect.y = actor->frame_height * (actor->animation_key + 7);
-		actor->state = MOVING_LEFT;
-		// Left boundary
-		if (actor->dest_rect.x < 0)
-            actor->dest_rect.x = 0; 
-	}
-	else if (app->key_state[SDL_SCANCODE_UP]) {
-		actor->dest_rect.y -= actor->speed * app->delta_time;
-		// Animation moving up
-		actor->src_rect.y = actor->frame_height * (actor->animation_key + 11);
-		actor->state = MOVING_UP;
-		// Upper boundary
-		if (actor->dest_rect.y < 0)
-            actor->dest_rect.y = 0;
-	}
-	else if (app->key_state[SDL_SCANCODE_DOWN]) {
-		actor->dest_rect.y += actor->speed * app->delta_time;
-		// Animation moving down
-		actor->src_rect.y = actor->frame_height * (actor->animation_key + 5);
-		actor->state = MOVING_DOWN;
-		// Bottom boundary
-		if (actor->dest_rect.y + actor->dest_rect.h > (int)config.window_height)
-            actor->dest_rect.y = config.window_height - actor->dest_rect.h;
-	}
-	else {
-		// Animation idle
-		if (actor->state != IDLE) 
-			actor->src_rect.y = actor->frame_height * actor->state;
-		actor->state = IDLE;
-	}
- 
-	app->frame_time += app->delta_time;
-
-	if (app->frame_time >= 0.20f) {
-		app->frame_time = 0;
-		actor->src_rect.x += actor->frame_widht;
-		if (actor->state != IDLE && actor->src_rect.x >= actor->texture_width) {
-			actor->animation_key = (actor->animation_key + 1) % 2;
+	*velocity = (velocity_t){0, 0};
+	if (app->key_state[SDL_SCANCODE_RIGHT])
+		velocity->x = speed;
+	else if (app->key_state[SDL_SCANCODE_LEFT])
+		velocity->x = -speed;
+	else if (app->key_state[SDL_SCANCODE_UP])
+		velocity->y = -speed;
+	else if (app->key_state[SDL_SCANCODE_DOWN])
+		velocity->y = speed;
+}
+
+// Every system below gets one chunk holding its components at a time and reads nothing else.
+// Chunks of a system run in parallel, so a system only writes the rows of its own chunk.
+// Actors come and go through the commands of the chunk, applied once every system is done.
+
+// Keeps the positions of the previous step for interpolation
+void snapshot_chunk(app_t *app, const ecs_query_t *chunk, ecs_commands_t *commands) {
+	(void)app;
+	(void)commands;
+	SDL_memcpy(ecs_query_column(chunk, COMPONENT_PREVIOUS), ecs_query_column(chunk, COMPONENT_POSITION),
+			   sizeof(position_t) * ecs_query_count(chunk));
+}
+
+// Moves actors and keeps them in the world, an edge turns wanderers back and stops the player until the next input
+void move_chunk(app_t *app, const ecs_query_t *chunk, ecs_commands_t *commands) {
+	(void)commands;
+	position_t *position = ecs_query_column(chunk, COMPONENT_POSITION);
+	velocity_t *velocity = ecs_query_column(chunk, COMPONENT_VELOCITY);
+	const extent_t *extent = ecs_query_column(chunk, COMPONENT_EXTENT);
+	const bounce_t *bounce = ecs_query_column(chunk, COMPONENT_BOUNCE);
+	app->integrate(&position->x, &velocity->x, &extent->w, &bounce->x, ecs_query_count(chunk), app->delta_time, app->limit);
+}
+
+// State follows the velocity
+void state_chunk(app_t *app, const ecs_query_t *chunk, ecs_commands_t *commands) {
+	(void)app;
+	(void)commands;
+	const velocity_t *velocity = ecs_query_column(chunk, COMPONENT_VELOCITY);
+	animation_t *animation = ecs_query_column(chunk, COMPONENT_ANIMATION);
+	for (int i = 0, count = ecs_query_count(chunk); i < count; ++i) {
+		float vx = velocity[i].x, vy = velocity[i].y;
+		if (vx == 0 && vy == 0)
+			animation[i].state = IDLE;
+		else if (SDL_fabsf(vx) >= SDL_fabsf(vy))
+			animation[i].state = vx > 0 ? MOVING_RIGHT : MOVING_LEFT;
+		else
+			animation[i].state = vy > 0 ? MOVING_DOWN : MOVING_UP;
+		if (animation[i].state != IDLE)
+			animation[i].facing = animation[i].state;
+	}
+}
+
+// Clip of the state
+void clip_chunk(app_t *app, const ecs_query_t *chunk, ecs_commands_t *commands) {
+	(void)commands;
+	animation_t *animation = ecs_query_column(chunk, COMPONENT_ANIMATION);
+	anim_timer_t *timer = ecs_query_column(chunk, COMPONENT_TIMER);
+	const sprite_t *sprite = ecs_query_column(chunk, COMPONENT_SPRITE);
+	for (int i = 0, count = ecs_query_count(chunk); i < count; ++i) {
+		const anim_table_t *anims = app->registry.species[sprite[i].species].anims;
+		play_clip(&animation[i], &timer[i], anims, animation[i].state == IDLE ? idle_clips[animation[i].facing] : walk_clips[animation[i].state]);
+	}
+}
+
+// Every actor runs on its own clock, then the frames reached are looked up in one pass
+void animation_chunk(app_t *app, const ecs_query_t *chunk, ecs_commands_t *commands) {
+	(void)commands;
+	const animation_t *animation = ecs_query_column(chunk, COMPONENT_ANIMATION);
+	anim_timer_t *timer = ecs_query_column(chunk, COMPONENT_TIMER);
+	source_t *source = ecs_query_column(chunk, COMPONENT_SOURCE);
+	const sprite_t *sprite = ecs_query_column(chunk, COMPONENT_SPRITE);
+	int count = ecs_query_count(chunk);
+	anim_step(timer, count, app->delta_time);
+	for (int i = 0; i < count; ++i)
+		source[i].rect = app->registry.species[sprite[i].species].anims->clips[animation[i].clip].frames[timer[i].frame];
+}
+
+// Wanderers whose time is up leave, one of the same species walks in somewhere else in their place
+void life_chunk(app_t *app, const ecs_query_t *chunk, ecs_commands_t *commands) {
+	life_t *life = ecs_query_column(chunk, COMPONENT_LIFE);
+	const sprite_t *sprite = ecs_query_column(chunk, COMPONENT_SPRITE);
+	const ecs_entity_t *entity = ecs_query_entities(chunk);
+	for (int i = 0, count = ecs_query_count(chunk); i < count; ++i) {
+		if ((life[i].left -= app->delta_time) > 0)
+			continue;
+
+		uint32_t seed = life[i].seed;
+		const position_t position = {random_unit(&seed) * app->limit[0], random_unit(&seed) * app->limit[1]};
+		const velocity_t velocity = wander_velocity(app->registry.species[sprite[i].species].speed, &seed);
+		const life_t next = {LIFE_MIN + random_unit(&seed) * (LIFE_MAX - LIFE_MIN), seed};
+
+		// The rest of the wanderer, clip and frame included, carries over
+		ecs_defer_destroy(commands, entity[i]);
+		ecs_defer_create(commands, WANDERER_MASK);
+		ecs_defer_set(commands, ECS_ENTITY_NONE, COMPONENT_POSITION, &position, sizeof(position));
+		ecs_defer_set(commands, ECS_ENTITY_NONE, COMPONENT_PREVIOUS, &position, sizeof(position));
+		ecs_defer_set(commands, ECS_ENTITY_NONE, COMPONENT_VELOCITY, &velocity, sizeof(velocity));
+		ecs_defer_set(commands, ECS_ENTITY_NONE, COMPONENT_LIFE, &next, sizeof(next));
+		for (int c = COMPONENT_EXTENT; c <= COMPONENT_SPRITE; ++c)
+			ecs_defer_set(commands, ECS_ENTITY_NONE, c, (const uint8_t *)ecs_query_column(chunk, c) + component_sizes[c] * i, component_sizes[c]);
+	}
+}
+
+static void run_chunks(void *data, int begin, int end) {
+	system_t *system = data;
+	for (int i = begin; i < end; ++i)
+		system->fn(system->app, &system->chunks[i], &system->commands[i]);
+}
+
+// Queues a job per chunk of the system, started once after is done
+void queue_system(app_t *app, system_t *system, job_counter_t *after) {
+	// A system without chunks still queues one empty job, the next system waits on it
+	int count = ecs_query_chunks(&app->game.world, system->mask, system->chunks, system->capacity);
+	if (SDL_max(count, 1) > system->capacity) {
+		int capacity = SDL_max(count, 1) * 2;
+		ecs_query_t *chunks = realloc(system->chunks, sizeof(ecs_query_t) * capacity);
+		if (chunks)
+			system->chunks = chunks;
+		ecs_commands_t *commands = chunks ? realloc(system->commands, sizeof(ecs_commands_t) * capacity) : NULL;
+		if (commands) {
+			for (int i = system->capacity; i < capacity; ++i)
+				ecs_commands_init(&commands[i]);
+			system->commands = commands;
 		}
-		actor->src_rect.x %= actor->texture_width;
+		job_t *jobs = commands ? realloc(system->jobs, sizeof(job_t) * capacity) : NULL;
+		if (!jobs) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to queue %d chunks.\n", count);
+			exit(EXIT_FAILURE);
+		}
+		system->jobs = jobs;
+		system->capacity = capacity;
+		ecs_query_chunks(&app->game.world, system->mask, system->chunks, system->capacity);
+	}
+
+	system->app = app;
+	system->count = count;
+	job_counter_init(&system->done);
+	job_parallel_for(&app->jobs, system->jobs, count, 1, run_chunks, system, &system->done, after);
+}
+
+// Cells as big as the largest sprite, so an actor only ever overlaps the cells around its own
+bool init_grid(app_t *app, config_t config) {
+	int cell_size = 1;
+	for (int i = 0; i < app->registry.count; ++i) {
+		const species_t *species = &app->registry.species[i];
+		cell_size = SDL_max(cell_size, SDL_max(species->anims->frame_w, species->anims->frame_h) * species->scale);
 	}
+	return spatial_grid_init(&app->game.grid, 0, 0, (float)config.world_width, (float)config.world_height, (float)cell_size);
 }
 
-bool load_actor(app_t *app, actor_t *actor, config_t config, const char *actor_src) {
-	// load and initialize actor
-	actor->texture = IMG_LoadTexture(app->renderer, actor_src);
-	if (!actor->texture) {
-		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not load actor texture into graphics hardware memory: %s\n", SDL_GetError());
-		return false;
+// Gathers the bodies and inserts them in the grid and the sweep in one pass. Chunk order only changes
+// when actors come and go, so steps where nobody crossed a cell skip the sort, and the x order of the
+// last step is almost right.
+void update_bodies(app_t *app) {
+	game_t *game = &app->game;
+	int count = game->world.entity_count;
+	if (count > game->body_capacity) {
+		body_t *bodies = realloc(game->bodies, sizeof(body_t) * count);
+		if (!bodies) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for %d bodies.\n", count);
+			exit(EXIT_FAILURE);
+		}
+		game->bodies = bodies;
+		game->body_capacity = count;
 	}
+	if (!spatial_grid_begin(&game->grid, count) || !sweep_begin(&game->sweep, count))
+		exit(EXIT_FAILURE);
 
-	SDL_Log("Loading actor texture into graphics memory\n");
-	SDL_QueryTexture(actor->texture, NULL, NULL, &actor->texture_width, &actor->texture_height);
+	game->body_count = 0;
+	ecs_query_t query = ecs_query(&game->world, ECS_COMPONENT(COMPONENT_POSITION) | ECS_COMPONENT(COMPONENT_EXTENT) |
+										   ECS_COMPONENT(COMPONENT_PREVIOUS) | ECS_COMPONENT(COMPONENT_VELOCITY) |
+										   ECS_COMPONENT(COMPONENT_BOUNCE) | ECS_COMPONENT(COMPONENT_SOURCE) |
+										   ECS_COMPONENT(COMPONENT_SPRITE));
+	while (ecs_query_next(&query)) {
+		position_t *position = ecs_query_column(&query, COMPONENT_POSITION);
+		const position_t *previous = ecs_query_column(&query, COMPONENT_PREVIOUS);
+		const extent_t *extent = ecs_query_column(&query, COMPONENT_EXTENT);
+		velocity_t *velocity = ecs_query_column(&query, COMPONENT_VELOCITY);
+		const bounce_t *bounce = ecs_query_column(&query, COMPONENT_BOUNCE);
+		const source_t *source = ecs_query_column(&query, COMPONENT_SOURCE);
+		const sprite_t *sprite = ecs_query_column(&query, COMPONENT_SPRITE);
+		const ecs_entity_t *entity = ecs_query_entities(&query);
+		for (int i = 0, n = ecs_query_count(&query); i < n; ++i) {
+			int id = game->body_count++;
+			body_t *body = &game->bodies[id];
+			const collision_mask_t *mask = &app->registry.species[sprite[i].species].mask;
+			*body = (body_t){
+				.position = &position[i],
+				.previous = &previous[i],
+				.velocity = &velocity[i],
+				.bounce = &bounce[i],
+				.x = position[i].x + extent[i].w * 0.5f,
+				.y = position[i].y + extent[i].h * 0.5f,
+				.mask = mask,
+				.frame = collision_mask_frame(mask, &source[i].rect),
+				.left = (int)SDL_floorf(position[i].x),
+				.top = (int)SDL_floorf(position[i].y),
+			};
+			if (entity[i] == game->player)
+				game->player_body = id;
+			spatial_grid_insert(&game->grid, (uint32_t)id, body->x, body->y);
+			sweep_insert(&game->sweep, (uint32_t)id, position[i].x, position[i].y,
+						 position[i].x + extent[i].w, position[i].y + extent[i].h);
+		}
+	}
+	spatial_grid_end(&game->grid);
+	if (!sweep_end(&game->sweep))
+		exit(EXIT_FAILURE);
+}
 
-	actor->frame_widht = actor->texture_width / 4;
-	actor->frame_height = actor->texture_height / 13;
-	
+// Wanderers close to the player and still heading towards it turn back
+void flee_player(app_t *app) {
+	game_t *game = &app->game;
+	const body_t *player = &game->bodies[game->player_body];
+	uint32_t near[FLEE_MAX];
+	int count = SDL_min(spatial_grid_query_radius(&game->grid, player->x, player->y, FLEE_RADIUS, near, FLEE_MAX), FLEE_MAX);
+	for (int i = 0; i < count; ++i) {
+		body_t *body = &game->bodies[near[i]];
+		velocity_t *velocity = body->velocity;
+		if ((int)near[i] != game->player_body && velocity->x * (player->x - body->x) + velocity->y * (player->y - body->y) > 0)
+			*velocity = (velocity_t){-velocity->x, -velocity->y};
+	}
+}
 
-	// For Animation
-	actor->src_rect.x = actor->src_rect.y = 0;
-	actor->src_rect.w = actor->frame_widht;
-	actor->src_rect.h = actor->frame_height;
+// An actor walking into another goes back to where it was before the step and takes its bounce,
+// like at an edge of the world. One moving away is left alone, so actors that overlap can part.
+static void collide(body_t *body, const body_t *other) {
+	velocity_t *velocity = body->velocity;
+	if (velocity->x * (other->x - body->x) + velocity->y * (other->y - body->y) <= 0)
+		return;
+	*body->position = *body->previous;
+	*velocity = (velocity_t){velocity->x * body->bounce->x, velocity->y * body->bounce->y};
+}
 
-	// Size + position
-	actor->dest_rect.w = actor->frame_widht * 5;
-	actor->dest_rect.h = actor->frame_height * 5;
-	#ifdef INIT_ACTOR // Needs fix
-	actor->dest_rect.x = (config.window_width - actor->dest_rect.w) / 2;
-	actor->dest_rect.y = (config.window_height - actor->dest_rect.h) / 2;
-	#else
-	(void)config;
-	#endif
-	actor->speed = 500.0f;
+// Narrow phase over the broad phase pairs, actors whose opaque pixels touch collide
+void update_contacts(app_t *app) {
+	const sweep_t *sweep = &app->game.sweep;
+	for (int i = 0; i < sweep->pair_count; ++i) {
+		body_t *a = &app->game.bodies[sweep->pairs[i].a], *b = &app->game.bodies[sweep->pairs[i].b];
+		if (collision_mask_overlap(a->mask, a->frame, a->left, a->top, b->mask, b->frame, b->left, b->top)) {
+			collide(a, b);
+			collide(b, a);
+		}
+	}
+}
 
-	return true;
+// Sheets decoded at runtime give the collision masks of their species, reloaded ones replace the old
+void on_sheet_loaded(void *userdata, int region, const SDL_Surface *surface) {
+	app_t *app = userdata;
+	registry_sheet_loaded(&app->registry, region, surface, &app->pages);
+	// Sprites drawn from the region look the same to the dirty rects but their pixels changed
+	app->redraw = true;
+	SDL_Rect rect;
+	int texture = atlas_pages_texture(&app->pages, region, &rect);
+	if (app->soft_mode && texture != TEXTURE_NONE)
+		soft_render_upload(&app->soft, texture, rect.x, rect.y, surface);
+}
+
+void init_systems(app_t *app) {
+	static const system_t systems[SYSTEM_COUNT] = {
+#define SYSTEM_ENTRY(id, components, function) [id] = {.mask = (components), .fn = function},
+		SYSTEMS(SYSTEM_ENTRY)
+#undef SYSTEM_ENTRY
+	};
+	SDL_memcpy(app->systems, systems, sizeof(systems));
+}
+
+// One simulation step, each system starts once the one before is done
+void step_systems(app_t *app) {
+	job_counter_t *after = NULL;
+	for (int i = 0; i < SYSTEM_COUNT; ++i) {
+		queue_system(app, &app->systems[i], after);
+		after = &app->systems[i].done;
+	}
+	job_wait(&app->jobs, after);
+
+	// Chunk order, so a step comes out the same whatever the threads did
+	for (int i = 0; i < SYSTEM_COUNT; ++i)
+		for (int c = 0; c < app->systems[i].count; ++c)
+			ecs_flush(&app->game.world, &app->systems[i].commands[c]);
 }
 
-bool add_actor(game_t *game, actor_t *actor) {
-	game->actors = realloc(game->actors, sizeof(actor_t *) * (game->actor_count + 1));
-	if (!game->actors) { 
-		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to reallocate.\n");
+bool set_species(app_t *app, ecs_entity_t actor, int id) {
+	const species_t *species = registry_get(&app->registry, id);
+	if (!species) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Species %d is not registered\n", id);
 		return false;
 	}
-	game->actors[game->actor_count++] = actor;
 
+	// Sheets missing from the pack are only loaded once an actor uses them
+	sprite_t *sprite = ecs_get(&app->game.world, actor, COMPONENT_SPRITE);
+	const animation_t *animation = ecs_get(&app->game.world, actor, COMPONENT_ANIMATION);
+	anim_timer_t *timer = ecs_get(&app->game.world, actor, COMPONENT_TIMER);
+	sprite->species = id;
+	*(extent_t *)ecs_get(&app->game.world, actor, COMPONENT_EXTENT) = (extent_t){
+		(float)(species->anims->frame_w * species->scale),
+		(float)(species->anims->frame_h * species->scale),
+	};
+	if (species->atlas_sheet < 0)
+		registry_sheet(&app->registry, id, &app->pages, &app->loader);
+
+	// Clips of the new species may be shorter or slower
+	anim_timer_play(timer, &species->anims->clips[animation->clip]);
+	source_t *source = ecs_get(&app->game.world, actor, COMPONENT_SOURCE);
+	source->rect = species->anims->clips[animation->clip].frames[timer->frame];
+	return true;
+}
+
+// Adds an idle actor of a species facing down with the components of mask, ECS_ENTITY_NONE on failure.
+// Its velocity is multiplied by bounce when it hits an edge of the world.
+ecs_entity_t spawn_actor(app_t *app, ecs_mask_t mask, int species, float x, float y, float vx, float vy, float bounce) {
+	ecs_entity_t actor = ecs_create(&app->game.world, mask);
+	if (actor == ECS_ENTITY_NONE)
+		return ECS_ENTITY_NONE;
+	*(position_t *)ecs_get(&app->game.world, actor, COMPONENT_POSITION) = (position_t){x, y};
+	*(position_t *)ecs_get(&app->game.world, actor, COMPONENT_PREVIOUS) = (position_t){x, y};
+	*(velocity_t *)ecs_get(&app->game.world, actor, COMPONENT_VELOCITY) = (velocity_t){vx, vy};
+	*(bounce_t *)ecs_get(&app->game.world, actor, COMPONENT_BOUNCE) = (bounce_t){bounce, bounce};
+	*(animation_t *)ecs_get(&app->game.world, actor, COMPONENT_ANIMATION) = (animation_t){
+		.state = IDLE,
+		.facing = MOVING_DOWN,
+		.clip = CLIP_IDLE_DOWN,
+	};
+	if (!set_species(app, actor, species)) {
+		ecs_remove(&app->game.world, actor);
+		return ECS_ENTITY_NONE;
+	}
+	return actor;
+}
+
+// Actors of random species walking straight, turning back at the edges of the world
+bool spawn_wanderers(app_t *app, config_t config) {
+	for (int i = 0; i < config.actor_count; ++i) {
+		int species = rand() % app->registry.count;
+		float x = (float)(rand() % config.world_width);
+		float y = (float)(rand() % config.world_height);
+		uint32_t seed = (uint32_t)rand() | 1;
+		velocity_t velocity = wander_velocity(app->registry.species[species].speed, &seed);
+		ecs_entity_t actor = spawn_actor(app, WANDERER_MASK, species, x, y, velocity.x, velocity.y, -1.0f);
+		if (actor == ECS_ENTITY_NONE)
+			return false;
+		*(life_t *)ecs_get(&app->game.world, actor, COMPONENT_LIFE) = (life_t){LIFE_MIN + random_unit(&seed) * (LIFE_MAX - LIFE_MIN), seed};
+		// Random phase, so a crowd of one species does not step in lockstep
+		anim_timer_t *timer = ecs_get(&app->game.world, actor, COMPONENT_TIMER);
+		timer->elapsed = timer->duration * (float)rand() / ((float)RAND_MAX + 1.0f);
+	}
+	if (config.actor_count)
+		SDL_Log("Spawned %d actors\n", config.actor_count);
 	return true;
 }
 
-void handle_input(app_t *app, config_t config) {
+// Texture id and frame to draw for an actor, TEXTURE_NONE while its sheet is loading
+int get_actor_frame(app_t *app, const source_t *source, const sprite_t *sprite, atlas_frame_t *frame) {
+	const species_t *species = &app->registry.species[sprite->species];
+	const SDL_Rect src_rect = source->rect;
+
+	// Whole sheet in an atlas page, also holds the sheet reloaded after an edit
+	SDL_Rect region;
+	int texture = species->requested ? atlas_pages_texture(&app->pages, species->region, &region) : TEXTURE_NONE;
+	if (texture != TEXTURE_NONE) {
+		*frame = (atlas_frame_t){
+			.src = {region.x + src_rect.x, region.y + src_rect.y, src_rect.w, src_rect.h},
+		};
+		return texture;
+	}
+
+	if (species->atlas_sheet >= 0) {
+		// Packed sheet, frames are trimmed
+		const atlas_frame_t *packed = atlas_frame(&app->atlas, species->atlas_sheet,
+												  src_rect.x / species->anims->frame_w, src_rect.y / species->anims->frame_h);
+		if (!packed)
+			return TEXTURE_NONE;
+		*frame = *packed;
+		return app->atlas.texture;
+	}
+	return TEXTURE_NONE;
+}
+
+void draw_actor(app_t *app, const position_t *position, const source_t *source, const sprite_t *sprite) {
+	const SDL_Color tint = {255, 255, 255, 255};
+	const species_t *species = &app->registry.species[sprite->species];
+	const float scale = (float)species->scale;
+	float x = position->x, y = position->y;
+	// Feet of the untrimmed frame, lower actors are drawn over the ones behind them
+	const float depth = y + species->anims->frame_h * scale;
+
+	// Destinations stay in floats, positions are not truncated to whole pixels
+	atlas_frame_t frame;
+	int texture = get_actor_frame(app, source, sprite, &frame);
+	if (texture == TEXTURE_NONE) {
+		SDL_FRect world_rect = {x, y, species->anims->frame_w * scale, species->anims->frame_h * scale};
+		SDL_FRect dest_rect = camera_to_screen(&app->camera, &world_rect);
+		render_queue_submit(&app->queue, LAYER_ACTORS, depth, app->placeholder, NULL, &dest_rect, tint, SDL_FLIP_NONE);
+		return;
+	}
+
+	// Draw only the visible pixels of the frame, the transparent border is trimmed away
+	if (frame.src.w > 0) {
+		SDL_FRect world_rect = {
+			x + frame.offset_x * scale,
+			y + frame.offset_y * scale,
+			frame.src.w * scale,
+			frame.src.h * scale,
+		};
+		SDL_FRect dest_rect = camera_to_screen(&app->camera, &world_rect);
+		render_queue_submit(&app->queue, LAYER_ACTORS, depth, texture, &frame.src, &dest_rect, tint, SDL_FLIP_NONE);
+	}
+}
+
+// Centres the view on the player where it is drawn, the window size may have changed
+void update_camera(app_t *app) {
+	int width, height;
+	if (SDL_GetRendererOutputSize(app->renderer, &width, &height) == 0)
+		camera_resize(&app->camera, (float)width, (float)height);
+
+	const position_t *position = ecs_get(&app->game.world, app->game.player, COMPONENT_POSITION);
+	const position_t *previous = ecs_get(&app->game.world, app->game.player, COMPONENT_PREVIOUS);
+	const extent_t *extent = ecs_get(&app->game.world, app->game.player, COMPONENT_EXTENT);
+	camera_follow(&app->camera,
+				  previous->x + (position->x - previous->x) * app->alpha + extent->w * 0.5f,
+				  previous->y + (position->y - previous->y) * app->alpha + extent->h * 0.5f);
+}
+
+// Queues the actors in view, draw_queue, draw_soft or draw_dirty_rects draws them
+void draw_system(app_t *app) {
+	// Actors are drawn between their last two steps, so motion is smooth at any display rate
+	const float alpha = app->alpha;
+	const SDL_FRect view = camera_view(&app->camera);
+	const float bounds[4] = {view.x - CULL_MARGIN, view.y - CULL_MARGIN, view.x + view.w + CULL_MARGIN, view.y + view.h + CULL_MARGIN};
+	// A chunk holds fewer actors than positions fit in it
+	int visible[ECS_CHUNK_SIZE / sizeof(position_t)];
+
+	ecs_query_t query = ecs_query(&app->game.world, ECS_COMPONENT(COMPONENT_POSITION) | ECS_COMPONENT(COMPONENT_PREVIOUS) |
+												   ECS_COMPONENT(COMPONENT_EXTENT) | ECS_COMPONENT(COMPONENT_SOURCE) |
+												   ECS_COMPONENT(COMPONENT_SPRITE));
+	while (ecs_query_next(&query)) {
+		const position_t *position = ecs_query_column(&query, COMPONENT_POSITION);
+		const position_t *previous = ecs_query_column(&query, COMPONENT_PREVIOUS);
+		const extent_t *extent = ecs_query_column(&query, COMPONENT_EXTENT);
+		const source_t *source = ecs_query_column(&query, COMPONENT_SOURCE);
+		const sprite_t *sprite = ecs_query_column(&query, COMPONENT_SPRITE);
+
+		// Off-screen actors never reach the render queue
+		int count = app->cull(&position->x, &extent->w, ecs_query_count(&query), bounds, visible);
+		for (int k = 0; k < count; ++k) {
+			const int i = visible[k];
+			position_t drawn = {
+				previous[i].x + (position[i].x - previous[i].x) * alpha,
+				previous[i].y + (position[i].y - previous[i].y) * alpha,
+			};
+			draw_actor(app, &drawn, &source[i], &sprite[i]);
+		}
+	}
+}
+
+// Draws the queued sprites, sorted once, then one draw call per texture however many actors share it
+void draw_queue(app_t *app) {
+	render_queue_drain(&app->queue, &app->textures, &app->batch);
+	sprite_batch_flush(&app->batch);
+}
+
+// Draws the queued sprites on the CPU across the job threads, then shows the frame as one texture
+void draw_soft(app_t *app) {
+	int width, height;
+	SDL_Texture *frame = NULL;
+	if (SDL_GetRendererOutputSize(app->renderer, &width, &height) == 0) {
+		render_queue_sort(&app->queue);
+		frame = soft_render_draw(&app->soft, &app->queue, &app->jobs, width, height);
+	}
+	render_queue_clear(&app->queue);
+	if (frame)
+		SDL_RenderCopy(app->renderer, frame, NULL, NULL);
+}
+
+// Redraws the parts of the window surface where queued sprites differ from the last frame and pushes only those
+void draw_dirty_rects(app_t *app) {
+	int width, height;
+	if (SDL_GetRendererOutputSize(app->renderer, &width, &height) != 0) {
+		render_queue_clear(&app->queue);
+		return;
+	}
+	dirty_rects_begin(&app->dirty, width, height);
+	if (app->redraw)
+		dirty_rects_invalidate(&app->dirty);
+	app->redraw = false;
+	dirty_rects_diff(&app->dirty, app->queue.items, app->queue.count);
+
+	int count;
+	const SDL_Rect *rects = dirty_rects_get(&app->dirty, &count);
+	render_queue_sort(&app->queue);
+	for (int i = 0; i < count; ++i) {
+		// Background first, then every sprite touching the rect, clipped to it
+		SDL_RenderSetClipRect(app->renderer, &rects[i]);
+		SDL_RenderFillRect(app->renderer, &rects[i]);
+		render_queue_draw(&app->queue, &app->textures, &app->batch, &rects[i]);
+		sprite_batch_flush(&app->batch);
+	}
+	SDL_RenderSetClipRect(app->renderer, NULL);
+	render_queue_clear(&app->queue);
+
+	if (count) {
+		SDL_RenderFlush(app->renderer);
+		SDL_UpdateWindowSurfaceRects(app->window, rects, count);
+	}
+}
+
+void handle_input(app_t *app) {
 	SDL_Event event;
 
 	while(SDL_PollEvent(&event)) {
@@ -257,34 +892,21 @@ void handle_input(app_t *app, config_t config) {
 				}
 				return;
 
+			case SDLK_EQUALS:
+			case SDLK_KP_PLUS:
+				camera_set_zoom(&app->camera, app->camera.zoom * ZOOM_STEP);
+				break;
+
+			case SDLK_MINUS:
+			case SDLK_KP_MINUS:
+				camera_set_zoom(&app->camera, app->camera.zoom / ZOOM_STEP);
+				break;
+
 			case SDLK_c:
-				switch (++app->game.animal % 6) {
-				case CAT_GRAY:
-					if (!load_actor(app, app->game.actors[0], config, "player/CAT_GRAY.png")) exit(EXIT_FAILURE);
-					app->game.animal = CAT_GRAY;
-					break;
-				case CAT_ORANGE:
-					if (!load_actor(app, app->game.actors[0], config, "player/CAT_ORANGE.png")) exit(EXIT_FAILURE);
-					app->game.animal = CAT_ORANGE;
-					break;
-				case FOX:
-					if (!load_actor(app, app->game.actors[0], config, "player/FOX.png")) exit(EXIT_FAILURE);
-					app->game.animal = FOX;
-					break;
-				case BIRD_BLUE:
-					if (!load_actor(app, app->game.actors[0], config, "player/BIRD_BLUE.png")) exit(EXIT_FAILURE);
-					app->game.animal = BIRD_BLUE;
-					break;
-				case BIRD_WHITE:
-					if (!load_actor(app, app->game.actors[0], config, "player/BIRD_WHITE.png")) exit(EXIT_FAILURE);
-					app->game.animal = BIRD_WHITE;
-					break;
-				case RACOON:
-					if (!load_actor(app, app->game.actors[0], config, "player/RACOON.png")) exit(EXIT_FAILURE);
-					app->game.animal = RACOON;
-					break;
+				// Next species of the manifest
+				app->game.species = (app->game.species + 1) % app->registry.count;
+				if (!set_species(app, app->game.player, app->game.species)) exit(EXIT_FAILURE);
 				break;
-			}
 
 			default:
 				break;
@@ -292,6 +914,17 @@ void handle_input(app_t *app, config_t config) {
 
 			break;
 
+		case SDL_WINDOWEVENT:
+			// The window surface lost its pixels or was replaced
+			if (event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+				app->redraw = true;
+			break;
+
+		case SDL_MOUSEWHEEL:
+			if (event.wheel.y)
+				camera_set_zoom(&app->camera, event.wheel.y > 0 ? app->camera.zoom * ZOOM_STEP : app->camera.zoom / ZOOM_STEP);
+			break;
+
 		default:
 			break;
 		}
@@ -300,6 +933,35 @@ void handle_input(app_t *app, config_t config) {
 
 
 void cleanup(app_t *app) {
+	job_system_destroy(&app->jobs);
+	for (int i = 0; i < SYSTEM_COUNT; ++i) {
+		for (int c = 0; c < app->systems[i].capacity; ++c)
+			ecs_commands_destroy(&app->systems[i].commands[c]);
+		free(app->systems[i].chunks);
+		free(app->systems[i].commands);
+		free(app->systems[i].jobs);
+	}
+	free(app->game.bodies);
+	spatial_grid_destroy(&app->game.grid);
+	sweep_destroy(&app->game.sweep);
+	ecs_destroy(&app->game.world);
+
+	// Loader callbacks point into the atlas pages and the cache, stop it first
+	SDL_Log("Stopping asset loader\n");
+	hot_reload_destroy(&app->watcher);
+	asset_loader_destroy(&app->loader);
+
+	SDL_Log("Releasing textures\n");
+	registry_destroy(&app->registry);
+	atlas_destroy(&app->atlas, &app->textures);
+	atlas_pages_destroy(&app->pages);
+	texture_cache_release(&app->textures, app->placeholder);
+	texture_cache_destroy(&app->textures);
+	render_queue_destroy(&app->queue);
+	sprite_batch_destroy(&app->batch);
+	dirty_rects_destroy(&app->dirty);
+	soft_render_destroy(&app->soft);
+
 	SDL_Log("Destroying renderer\n");
 	SDL_DestroyRenderer(app->renderer);
 
@@ -316,6 +978,12 @@ int main(int argc, char *argv[]) {
 	// Set app configuration
 	config_t config = {0};
 	if (!set_config(&config, argc, argv)) exit(EXIT_FAILURE);
+	if (config.bench_count) {
+		SDL_Init(0);
+		bool ok = integrate_bench(config.bench_count);
+		SDL_Quit();
+		exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
 
 	// Initialize SDL app
 	app_t app = {0};
@@ -324,31 +992,118 @@ int main(int argc, char *argv[]) {
 	// Initialize game
 	game_t game = {0};
 	app.game = game;
-	app.game.actor_count = 0;
-	app.game.animal = CAT_GRAY;				// Default is gray cat :/
+	if (!ecs_init(&app.game.world, component_sizes, COMPONENT_COUNT)) exit(EXIT_FAILURE);
+	if (!ecs_reserve(&app.game.world, ACTOR_MASK, 1)) exit(EXIT_FAILURE);						// The player
+	if (!ecs_reserve(&app.game.world, WANDERER_MASK, config.actor_count)) exit(EXIT_FAILURE);
+	init_systems(&app);
+
+	// Species come from the manifest, their sheets are loaded on first use
+	if (!registry_load(&app.registry, MANIFEST)) exit(EXIT_FAILURE);
+	app.game.species = registry_find(&app.registry, "CAT_GRAY");		// Default is gray cat :/
+	if (app.game.species == SPECIES_NONE) app.game.species = 0;
+	if (!init_grid(&app, config)) exit(EXIT_FAILURE);
+	app.pages.on_loaded = on_sheet_loaded;
+	app.pages.on_loaded_userdata = &app;
+	if (!sweep_init(&app.game.sweep)) exit(EXIT_FAILURE);
+	SDL_Log("Broad phase: %s\n", sweep_name(app.game.sweep.run));
 
-	// Load player texture into the game
-	actor_t actor = {.state = IDLE, .animation_key = 0};
-	if (!load_actor(&app, &actor, config, "player/CAT_GRAY.png")) exit(EXIT_FAILURE);
-	if (!add_actor(&app.game, &actor)) exit(EXIT_FAILURE);
+	// Upload pre-decoded sheets straight from the sprite pack when there is one
+	spk_pack_t pack;
+	app.atlas.texture = TEXTURE_NONE;
+	if (spk_open(&pack, SPRITE_PACK)) {
+		if (atlas_load_pack(&app.atlas, &app.textures, &pack, SPRITE_PACK)) {
+			// The blitter draws from its own copy of the same pixels
+			if (app.soft_mode) {
+				const spk_header_t *header = pack.header;
+				SDL_Surface *pixels = SDL_CreateRGBSurfaceWithFormatFrom((void *)pack.pixels, (int)header->width, (int)header->height,
+																		 SDL_BITSPERPIXEL(header->pixel_format), (int)header->pitch, header->pixel_format);
+				if (!pixels || !soft_render_upload(&app.soft, app.atlas.texture, 0, 0, pixels))
+					SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Sprite pack is not drawn by the software blitter: %s\n", SDL_GetError());
+				SDL_FreeSurface(pixels);
+			}
+			for (int i = 0; i < app.registry.count; ++i) {
+				species_t *species = &app.registry.species[i];
+				int sheet = atlas_find_sheet(&app.atlas, species->sheet);
+				// A pack made for another layout would draw the wrong frames
+				if (sheet >= 0 && (app.atlas.sheets[sheet].frame_w != species->anims->frame_w || app.atlas.sheets[sheet].frame_h != species->anims->frame_h)) {
+					SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Packed sheet of %s does not match its clips, repack it\n", species->name);
+					sheet = -1;
+				}
+				species->atlas_sheet = sheet;
+				if (sheet >= 0)
+					collision_mask_from_pack(&species->mask, &pack, sheet);
+			}
+		}
+		spk_close(&pack);
+	}
+
+	// Load player into the game
+	float player_x = 0, player_y = 0;
+	#ifdef INIT_ACTOR // Needs fix
+	const species_t *player_species = registry_get(&app.registry, app.game.species);
+	player_x = (config.window_width - player_species->anims->frame_w * player_species->scale) / 2.0f;
+	player_y = (config.window_height - player_species->anims->frame_h * player_species->scale) / 2.0f;
+	#endif
+	app.game.player = spawn_actor(&app, ACTOR_MASK, app.game.species, player_x, player_y, 0, 0, 0.0f);
+	if (app.game.player == ECS_ENTITY_NONE) exit(EXIT_FAILURE);
+	if (!spawn_wanderers(&app, config)) exit(EXIT_FAILURE);
 
 	// Game Loop
 	while (app.state != QUIT) {
 
-		app.prev_time = app.current_time;
-		app.current_time = SDL_GetTicks();
-		app.delta_time = (app.current_time - app.prev_time) / 1000.0f;  // Miliseconds passed
-		
+		app.prev_counter = app.current_counter;
+		app.current_counter = SDL_GetPerformanceCounter();
+		float frame_time = (float)((double)(app.current_counter - app.prev_counter) / (double)SDL_GetPerformanceFrequency());
+
 		// Handle input
-		handle_input(&app, config);
+		handle_input(&app);
 
 		if (app.state == PAUSED) continue;
 
-		handle_continuous_input(&app, app.game.actors[0], config);
+		// Edited sheets are decoded in the background and swapped in by the pump once uploaded
+		char changed[HOT_RELOAD_PATH_SIZE];
+		while (hot_reload_poll(&app.watcher, changed, sizeof(changed)))
+			registry_reload(&app.registry, changed, &app.pages, &app.loader);
+
+		// Sheets the loader could not take yet are asked for again
+		registry_retry(&app.registry, &app.pages, &app.loader);
 
-		SDL_RenderClear(app.renderer);																					// Clear the screen
-		SDL_RenderCopy(app.renderer, app.game.actors[0]->texture, &app.game.actors[0]->src_rect, &app.game.actors[0]->dest_rect);		
-		SDL_RenderPresent(app.renderer);																				// Trigger the double buffers for multiple rendering
+		// Upload decoded assets without going over the frame budget
+		asset_loader_pump(&app.loader, UPLOAD_BUDGET_MS);
+		// Sheets reloaded at another size leave holes, repack once the pages could shrink.
+		// The software blitter only has CPU copies of the pages it was given, it keeps its pages as they are.
+		if (!app.soft_mode && atlas_pages_fragmented(&app.pages) && atlas_pages_defragment(&app.pages))
+			app.redraw = true;
+
+		// Fixed steps for the time elapsed, the rest waits for the next frame
+		handle_continuous_input(&app);
+		app.accumulator += SDL_min(frame_time, MAX_FRAME_TIME);
+		while (app.accumulator >= app.delta_time) {
+			step_systems(&app);
+			update_bodies(&app);
+			flee_player(&app);
+			update_contacts(&app);
+			app.accumulator -= app.delta_time;
+		}
+		app.alpha = app.accumulator / app.delta_time;
+
+		update_camera(&app);
+		draw_system(&app);
+		if (app.dirty_mode) {
+			draw_dirty_rects(&app);
+			// Nothing waits for vsync without SDL_RenderPresent
+			SDL_Delay(1000 / FPS);
+		} else if (app.soft_mode) {
+			draw_soft(&app);
+			SDL_RenderPresent(app.renderer);
+			// Renderers without vsync would otherwise spin as fast as the blitter goes
+			if (!app.vsync)
+				SDL_Delay(1000 / FPS);
+		} else {
+			SDL_RenderClear(app.renderer);																				// Clear the screen
+			draw_queue(&app);
+			SDL_RenderPresent(app.renderer);																			// Trigger the double buffers for multiple rendering
+		}
 
 		// 60 fps
 		// SDL_Delay(1000 / FPS);
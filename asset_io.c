@@ -0,0 +1,551 @@
+#ifdef __linux__
+#define _GNU_SOURCE						// pread, syscall and MAP_POPULATE
+#endif
+
+#include "asset_io.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#define RING_ENTRIES 64
+#define RING_DRAIN_MS 1000					// Wait for reads in flight when the ring fails, then give up on them
+#define SLOT_NONE (-1)
+
+// One file being read
+typedef struct {
+	char *path;
+	asset_read_fn callback;
+	void *userdata;
+	int fd;
+	uint8_t *data;
+	size_t size;
+	size_t offset;						// Bytes read so far
+	int slot;							// Slot holding the data, SLOT_NONE when it has its own allocation
+} io_read_t;
+
+// Content of a finished read, behind the SDL_RWops
+typedef struct {
+	asset_io_t *io;
+	uint8_t *data;
+	size_t size;
+	size_t position;
+	int slot;
+} io_buffer_t;
+
+static uint8_t *take_buffer(asset_io_t *io, size_t size, int *slot) {
+	void *item;
+	if (size <= ASSET_IO_SLOT_SIZE && mpmc_queue_pop(&io->free_slots, &item)) {
+		*slot = (int)(intptr_t)item - 1;
+		return io->slots + (size_t)*slot * ASSET_IO_SLOT_SIZE;
+	}
+	*slot = SLOT_NONE;
+	return malloc(size);
+}
+
+static void give_buffer(asset_io_t *io, uint8_t *data, int slot) {
+	if (slot == SLOT_NONE)
+		free(data);
+	else
+		mpmc_queue_push(&io->free_slots, (void *)(intptr_t)(slot + 1));
+}
+
+// --- SDL_RWops over a finished read ---
+
+static Sint64 SDLCALL buffer_size(SDL_RWops *rw) {
+	io_buffer_t *buffer = rw->hidden.unknown.data1;
+	return (Sint64)buffer->size;
+}
+
+static Sint64 SDLCALL buffer_seek(SDL_RWops *rw, Sint64 offset, int whence) {
+	io_buffer_t *buffer = rw->hidden.unknown.data1;
+	Sint64 base = whence == RW_SEEK_SET ? 0 : whence == RW_SEEK_CUR ? (Sint64)buffer->position : (Sint64)buffer->size;
+	Sint64 position = base + offset;
+	if (position < 0 || position > (Sint64)buffer->size)
+		return SDL_SetError("Seek outside of the asset");
+	buffer->position = (size_t)position;
+	return position;
+}
+
+static size_t SDLCALL buffer_read(SDL_RWops *rw, void *ptr, size_t size, size_t maxnum) {
+	io_buffer_t *buffer = rw->hidden.unknown.data1;
+	if (size == 0)
+		return 0;
+	size_t count = (buffer->size - buffer->position) / size;
+	if (count > maxnum)
+		count = maxnum;
+	memcpy(ptr, buffer->data + buffer->position, count * size);
+	buffer->position += count * size;
+	return count;
+}
+
+static size_t SDLCALL buffer_write(SDL_RWops *rw, const void *ptr, size_t size, size_t num) {
+	(void)rw; (void)ptr; (void)size; (void)num;
+	SDL_SetError("Assets are read-only");
+	return 0;
+}
+
+static int SDLCALL buffer_close(SDL_RWops *rw) {
+	io_buffer_t *buffer = rw->hidden.unknown.data1;
+	give_buffer(buffer->io, buffer->data, buffer->slot);
+	free(buffer);
+	SDL_FreeRW(rw);
+	return 0;
+}
+
+static SDL_RWops *buffer_rw(asset_io_t *io, io_read_t *read) {
+	SDL_RWops *rw = SDL_AllocRW();
+	io_buffer_t *buffer = malloc(sizeof(io_buffer_t));
+	if (!rw || !buffer) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to read %s.\n", read->path);
+		if (rw)
+			SDL_FreeRW(rw);
+		free(buffer);
+		return NULL;
+	}
+
+	*buffer = (io_buffer_t){.io = io, .data = read->data, .size = read->size, .slot = read->slot};
+	rw->size = buffer_size;
+	rw->seek = buffer_seek;
+	rw->read = buffer_read;
+	rw->write = buffer_write;
+	rw->close = buffer_close;
+	rw->type = SDL_RWOPS_UNKNOWN;
+	rw->hidden.unknown.data1 = buffer;
+	read->data = NULL;					// Owned by the SDL_RWops now
+	return rw;
+}
+
+// Hands the file to the callback (or NULL when reading failed) and forgets the read
+static void finish(asset_io_t *io, io_read_t *read, bool ok) {
+#ifdef __linux__
+	if (read->fd >= 0)
+		close(read->fd);
+#endif
+	SDL_RWops *rw = ok ? buffer_rw(io, read) : NULL;
+	if (read->data)
+		give_buffer(io, read->data, read->slot);
+	read->callback(read->userdata, rw);
+	free(read->path);
+	free(read);
+}
+
+#ifdef __linux__
+// Opens the file and takes a buffer for all of it
+static bool open_read(asset_io_t *io, io_read_t *read) {
+	read->fd = open(read->path, O_RDONLY | O_CLOEXEC);
+	struct stat info;
+	if (read->fd < 0 || fstat(read->fd, &info) != 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not open %s: %s\n", read->path, strerror(errno));
+		return false;
+	}
+	if (info.st_size <= 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read %s: file is empty\n", read->path);
+		return false;
+	}
+
+	read->size = (size_t)info.st_size;
+	read->data = take_buffer(io, read->size, &read->slot);
+	if (!read->data) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to read %s.\n", read->path);
+		return false;
+	}
+	return true;
+}
+
+// Reads from the offset to the end of the file
+static bool read_rest(io_read_t *read) {
+	while (read->offset < read->size) {
+		ssize_t count = pread(read->fd, read->data + read->offset, read->size - read->offset, (off_t)read->offset);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read %s: %s\n", read->path, count < 0 ? strerror(errno) : "file was truncated");
+			return false;
+		}
+		read->offset += (size_t)count;
+	}
+	return true;
+}
+
+// --- io_uring, driven with raw syscalls ---
+
+struct io_ring {
+	int fd;
+	unsigned entries;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_map, *cq_map;
+	size_t sq_map_size, cq_map_size, sqes_size;
+	bool fixed;							// Slots are registered, reads into them skip the page pinning
+	io_read_t **reads;					// Reads given to the ring, queued or in flight
+	unsigned read_count;
+};
+
+static void ring_close(struct io_ring *ring) {
+	if (ring->sqes && ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_map && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map)
+		munmap(ring->cq_map, ring->cq_map_size);
+	if (ring->sq_map && ring->sq_map != MAP_FAILED)
+		munmap(ring->sq_map, ring->sq_map_size);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	free(ring->reads);
+	free(ring);
+}
+
+static struct io_ring *ring_open(asset_io_t *io) {
+	struct io_uring_params params = {0};
+	int fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+	if (fd < 0) {
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "io_uring is not available, reading with threads: %s\n", strerror(errno));
+		return NULL;
+	}
+
+	struct io_ring *ring = calloc(1, sizeof(struct io_ring));
+	if (!ring) {
+		close(fd);
+		return NULL;
+	}
+	ring->fd = fd;
+
+	// Plain reads need Linux 5.6, which is also when the ring started keeping the file position
+	if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "io_uring is too old, reading with threads\n");
+		ring_close(ring);
+		return NULL;
+	}
+
+	ring->entries = params.sq_entries;
+	ring->reads = malloc(sizeof(io_read_t *) * params.sq_entries);
+	if (!ring->reads) {
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Not enough memory for io_uring, reading with threads\n");
+		ring_close(ring);
+		return NULL;
+	}
+	ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_map) {
+		if (ring->cq_map_size > ring->sq_map_size)
+			ring->sq_map_size = ring->cq_map_size;
+		ring->cq_map_size = ring->sq_map_size;
+	}
+
+	ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	ring->cq_map = single_map ? ring->sq_map : mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED || ring->sqes == MAP_FAILED) {
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Could not map io_uring, reading with threads: %s\n", strerror(errno));
+		ring_close(ring);
+		return NULL;
+	}
+
+	uint8_t *sq = ring->sq_map;
+	uint8_t *cq = ring->cq_map;
+	ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+	ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	// Registered buffers stay pinned, the kernel does not map them again on every read
+	struct iovec iov[ASSET_IO_SLOTS];
+	for (int i = 0; i < ASSET_IO_SLOTS; ++i)
+		iov[i] = (struct iovec){io->slots + (size_t)i * ASSET_IO_SLOT_SIZE, ASSET_IO_SLOT_SIZE};
+	ring->fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iov, ASSET_IO_SLOTS) == 0;
+	if (!ring->fixed)
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Could not register read buffers: %s\n", strerror(errno));
+	return ring;
+}
+
+// Adds the rest of a read to the submission queue, the kernel sees it on the next io_uring_enter
+static void ring_queue(struct io_ring *ring, io_read_t *read) {
+	unsigned tail = *ring->sq_tail;
+	unsigned index = tail & *ring->sq_mask;
+	size_t left = read->size - read->offset;
+
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+	*sqe = (struct io_uring_sqe){
+		.opcode = read->slot != SLOT_NONE && ring->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ,
+		.fd = read->fd,
+		.off = read->offset,
+		.addr = (uintptr_t)(read->data + read->offset),
+		.len = left > (1u << 30) ? (1u << 30) : (unsigned)left,
+		.user_data = (uintptr_t)read,
+	};
+	if (sqe->opcode == IORING_OP_READ_FIXED)
+		sqe->buf_index = (uint16_t)read->slot;
+	ring->sq_array[index] = index;
+	atomic_store_explicit((_Atomic unsigned *)ring->sq_tail, tail + 1, memory_order_release);
+}
+
+static void ring_forget(struct io_ring *ring, io_read_t *read) {
+	for (unsigned i = 0; i < ring->read_count; ++i)
+		if (ring->reads[i] == read) {
+			ring->reads[i] = ring->reads[--ring->read_count];
+			return;
+		}
+}
+
+// The ring failed: every read it holds is finished with blocking reads, the ones the kernel keeps fail
+static void ring_drain(asset_io_t *io, struct io_ring *ring) {
+	// Entries past the kernel head were never submitted, moving the tail back takes them out of the ring
+	unsigned head = atomic_load_explicit((_Atomic unsigned *)ring->sq_head, memory_order_acquire);
+	for (unsigned i = head; i != *ring->sq_tail; ++i) {
+		io_read_t *read = (io_read_t *)(uintptr_t)ring->sqes[ring->sq_array[i & *ring->sq_mask]].user_data;
+		ring_forget(ring, read);
+		finish(io, read, read_rest(read));
+	}
+	atomic_store_explicit((_Atomic unsigned *)ring->sq_tail, head, memory_order_release);
+
+	// Reads in flight still complete into the completion queue, the rest of each file is read here
+	for (int waited = 0; ring->read_count > 0 && waited < RING_DRAIN_MS; ++waited) {
+		unsigned cq_head = *ring->cq_head;
+		unsigned cq_tail = atomic_load_explicit((_Atomic unsigned *)ring->cq_tail, memory_order_acquire);
+		for (; cq_head != cq_tail; ++cq_head) {
+			const struct io_uring_cqe *cqe = &ring->cqes[cq_head & *ring->cq_mask];
+			io_read_t *read = (io_read_t *)(uintptr_t)cqe->user_data;
+			ring_forget(ring, read);
+			if (cqe->res < 0) {
+				SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read %s: %s\n", read->path, strerror(-cqe->res));
+				finish(io, read, false);
+			} else {
+				read->offset += (size_t)cqe->res;
+				finish(io, read, read_rest(read));
+			}
+		}
+		atomic_store_explicit((_Atomic unsigned *)ring->cq_head, cq_head, memory_order_release);
+		if (ring->read_count > 0)
+			SDL_Delay(1);
+	}
+
+	// The kernel may still write into the buffers of reads it never answered, they are leaked rather than reused
+	while (ring->read_count > 0) {
+		io_read_t *read = ring->reads[--ring->read_count];
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read %s: io_uring did not answer\n", read->path);
+		read->data = NULL;
+		finish(io, read, false);
+	}
+}
+
+static int pool_main(void *data);
+
+static int ring_main(void *data) {
+	asset_io_t *io = data;
+	struct io_ring *ring = io->ring;
+	unsigned in_flight = 0;				// Submitted to the kernel
+	unsigned queued = 0;				// In the submission queue, not submitted yet
+
+	for (;;) {
+		// Every waiting request goes to the kernel with the same syscall
+		bool quit = atomic_load(&io->quit);
+		void *item;
+		while (!quit && in_flight + queued < ring->entries && mpmc_queue_pop(&io->requests, &item)) {
+			io_read_t *read = item;
+			if (!open_read(io, read)) {
+				finish(io, read, false);
+				continue;
+			}
+			ring->reads[ring->read_count++] = read;
+			ring_queue(ring, read);
+			queued++;
+		}
+
+		if (in_flight + queued == 0) {
+			// Nothing left for the kernel, reads still queued are failed by asset_io_stop
+			if (quit)
+				return 0;
+			SDL_SemWait(io->wake);
+			continue;
+		}
+
+		int submitted = (int)syscall(__NR_io_uring_enter, ring->fd, queued, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (submitted < 0) {
+			if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+				continue;
+			// Requests keep being served by this thread with blocking reads
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "io_uring_enter failed, reading with threads: %s\n", strerror(errno));
+			ring_drain(io, ring);
+			return pool_main(io);
+		}
+		in_flight += (unsigned)submitted;
+		queued -= (unsigned)submitted;
+
+		// Reap every completion, short reads are queued again for the rest of the file
+		unsigned head = *ring->cq_head;
+		unsigned tail = atomic_load_explicit((_Atomic unsigned *)ring->cq_tail, memory_order_acquire);
+		for (; head != tail; ++head) {
+			const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+			io_read_t *read = (io_read_t *)(uintptr_t)cqe->user_data;
+			in_flight--;
+
+			if (cqe->res <= 0) {
+				SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read %s: %s\n", read->path, cqe->res < 0 ? strerror(-cqe->res) : "file was truncated");
+				ring_forget(ring, read);
+				finish(io, read, false);
+			} else if ((read->offset += (size_t)cqe->res) < read->size) {
+				ring_queue(ring, read);
+				queued++;
+			} else {
+				ring_forget(ring, read);
+				finish(io, read, true);
+			}
+		}
+		atomic_store_explicit((_Atomic unsigned *)ring->cq_head, head, memory_order_release);
+	}
+}
+#endif
+
+// --- Fallback: blocking reads on a pool of threads ---
+
+static bool read_file(asset_io_t *io, io_read_t *read) {
+#ifdef __linux__
+	return open_read(io, read) && read_rest(read);
+#else
+	SDL_RWops *file = SDL_RWFromFile(read->path, "rb");
+	Sint64 size = file ? SDL_RWsize(file) : -1;
+	if (size <= 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not open %s: %s\n", read->path, SDL_GetError());
+		if (file)
+			SDL_RWclose(file);
+		return false;
+	}
+
+	read->size = (size_t)size;
+	read->data = take_buffer(io, read->size, &read->slot);
+	bool ok = read->data && SDL_RWread(file, read->data, read->size, 1) == 1;
+	if (!ok)
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read %s: %s\n", read->path, SDL_GetError());
+	SDL_RWclose(file);
+	return ok;
+#endif
+}
+
+static int pool_main(void *data) {
+	asset_io_t *io = data;
+
+	for (;;) {
+		SDL_SemWait(io->wake);
+		if (atomic_load(&io->quit))
+			return 0;
+
+		void *item;
+		if (!mpmc_queue_pop(&io->requests, &item))
+			continue;
+		io_read_t *read = item;
+		finish(io, read, read_file(io, read));
+	}
+}
+
+bool asset_io_init(asset_io_t *io, int threads) {
+	*io = (asset_io_t){0};
+	atomic_init(&io->quit, false);
+
+	if (threads < 1)
+		threads = 1;
+	if (threads > ASSET_IO_MAX_THREADS)
+		threads = ASSET_IO_MAX_THREADS;
+
+	io->slots = malloc((size_t)ASSET_IO_SLOTS * ASSET_IO_SLOT_SIZE);
+	if (!io->slots || !mpmc_queue_init(&io->requests, ASSET_IO_QUEUE_SIZE) || !mpmc_queue_init(&io->free_slots, ASSET_IO_SLOTS)) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for asset reads.\n");
+		return false;
+	}
+	for (int i = 0; i < ASSET_IO_SLOTS; ++i)
+		mpmc_queue_push(&io->free_slots, (void *)(intptr_t)(i + 1));
+
+	io->wake = SDL_CreateSemaphore(0);
+	if (!io->wake) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create I/O semaphore: %s\n", SDL_GetError());
+		return false;
+	}
+
+	SDL_ThreadFunction thread_main = pool_main;
+#ifdef __linux__
+	io->ring = ring_open(io);
+	if (io->ring) {
+		thread_main = ring_main;
+		threads = 1;
+	}
+#endif
+
+	for (int i = 0; i < threads; ++i) {
+		io->threads[i] = SDL_CreateThread(thread_main, "asset_io", io);
+		if (!io->threads[i]) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create I/O thread: %s\n", SDL_GetError());
+			return false;
+		}
+		io->thread_count++;
+	}
+	SDL_Log("Asset reads use %s\n", io->ring ? "io_uring" : "blocking reader threads");
+	return true;
+}
+
+void asset_io_stop(asset_io_t *io) {
+	atomic_store(&io->quit, true);
+	for (int i = 0; i < io->thread_count; ++i)
+		SDL_SemPost(io->wake);
+	for (int i = 0; i < io->thread_count; ++i)
+		SDL_WaitThread(io->threads[i], NULL);
+	io->thread_count = 0;
+
+	// Nobody reads anymore, answer what is left so callers can free their requests
+	void *item;
+	if (io->requests.cells)
+		while (mpmc_queue_pop(&io->requests, &item))
+			finish(io, item, false);
+}
+
+void asset_io_destroy(asset_io_t *io) {
+	asset_io_stop(io);
+#ifdef __linux__
+	if (io->ring)
+		ring_close(io->ring);
+#endif
+	mpmc_queue_destroy(&io->requests);
+	mpmc_queue_destroy(&io->free_slots);
+	if (io->wake)
+		SDL_DestroySemaphore(io->wake);
+	free(io->slots);
+	*io = (asset_io_t){0};
+}
+
+bool asset_io_read(asset_io_t *io, const char *path, asset_read_fn callback, void *userdata) {
+	io_read_t *read = malloc(sizeof(io_read_t));
+	char *path_copy = malloc(strlen(path) + 1);
+	if (!read || !path_copy) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to request %s.\n", path);
+		free(read);
+		free(path_copy);
+		return false;
+	}
+	strcpy(path_copy, path);
+	*read = (io_read_t){.path = path_copy, .callback = callback, .userdata = userdata, .fd = -1, .slot = SLOT_NONE};
+
+	if (!mpmc_queue_push(&io->requests, read)) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "I/O queue is full, dropping %s\n", path);
+		free(path_copy);
+		free(read);
+		return false;
+	}
+	SDL_SemPost(io->wake);
+	return true;
+}
@@ -0,0 +1,45 @@
+#ifndef ASSET_IO_H
+#define ASSET_IO_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL.h>
+
+#include "mpmc_queue.h"
+
+#define ASSET_IO_MAX_THREADS 8
+#define ASSET_IO_QUEUE_SIZE 256
+#define ASSET_IO_SLOTS 16					// Reusable read buffers, registered with io_uring when it is used
+#define ASSET_IO_SLOT_SIZE (256 * 1024)		// Bigger files get a buffer of their own
+
+// Called on an I/O thread with the whole file in memory, rw is NULL on failure and the callee closes it
+typedef void (*asset_read_fn)(void *userdata, SDL_RWops *rw);
+
+struct io_ring;
+
+// Reads whole files off the render thread: batched through io_uring on Linux, a pool of blocking readers elsewhere
+// or once the ring fails
+typedef struct {
+	SDL_Thread *threads[ASSET_IO_MAX_THREADS];
+	int thread_count;
+	SDL_sem *wake;							// Posted once per request
+	atomic_bool quit;
+	mpmc_queue_t requests;					// Files waiting to be read
+	uint8_t *slots;							// ASSET_IO_SLOTS buffers of ASSET_IO_SLOT_SIZE bytes
+	mpmc_queue_t free_slots;				// Slots not in use, stored as index + 1
+	struct io_ring *ring;					// NULL when io_uring is not available
+} asset_io_t;
+
+// Threads are only used by the fallback readers, io_uring needs a single one
+bool asset_io_init(asset_io_t *io, int threads);
+// Joins the I/O threads, reads still queued answer with NULL
+void asset_io_stop(asset_io_t *io);
+// Every SDL_RWops handed out must be closed before
+void asset_io_destroy(asset_io_t *io);
+
+// Queues a file, the callback gets a read-only SDL_RWops over its content
+bool asset_io_read(asset_io_t *io, const char *path, asset_read_fn callback, void *userdata);
+
+#endif // ASSET_IO_H
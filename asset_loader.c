@@ -0,0 +1,197 @@
+#include "asset_loader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL_image.h>
+
+typedef struct {
+	asset_loader_t *loader;
+	char *path;
+	asset_loaded_fn callback;
+	void *userdata;
+	int tag;
+	SDL_RWops *rw;						// Content of the file, set once it is read
+	SDL_Surface *surface;				// Set by the worker
+} asset_job_t;
+
+static void free_job(asset_job_t *job) {
+	if (job->rw)
+		SDL_RWclose(job->rw);
+	SDL_FreeSurface(job->surface);
+	free(job->path);
+	free(job);
+}
+
+static SDL_Surface *decode(const char *path, SDL_RWops *rw) {
+	if (!rw)
+		return NULL;					// Reading failed, already logged
+
+	SDL_Surface *surface = IMG_Load_RW(rw, 1);
+	if (!surface) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not decode %s: %s\n", path, IMG_GetError());
+		return NULL;
+	}
+
+	// Convert here so the render thread uploads without touching pixels
+	if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+		SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+		SDL_FreeSurface(surface);
+		if (!converted)
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not convert %s: %s\n", path, SDL_GetError());
+		surface = converted;
+	}
+	return surface;
+}
+
+static int worker_main(void *data) {
+	asset_loader_t *loader = data;
+
+	for (;;) {
+		SDL_SemWait(loader->wake);
+		if (atomic_load(&loader->quit))
+			return 0;
+
+		void *item;
+		if (!mpmc_queue_pop(&loader->requests, &item))
+			continue;
+
+		asset_job_t *job = item;
+		job->surface = decode(job->path, job->rw);
+		job->rw = NULL;					// Closed by IMG_Load_RW
+
+		// Render thread may lag behind, wait for room instead of dropping the surface
+		while (!mpmc_queue_push(&loader->done, job)) {
+			if (atomic_load(&loader->quit)) {
+				free_job(job);
+				return 0;
+			}
+			SDL_Delay(1);
+		}
+	}
+}
+
+bool asset_loader_init(asset_loader_t *loader, int worker_count) {
+	*loader = (asset_loader_t){0};
+	atomic_init(&loader->quit, false);
+	atomic_init(&loader->pending, 0);
+
+	if (worker_count < 1)
+		worker_count = 1;
+	if (worker_count > ASSET_LOADER_MAX_WORKERS)
+		worker_count = ASSET_LOADER_MAX_WORKERS;
+
+	if (!asset_io_init(&loader->io, worker_count))
+		return false;
+	if (!mpmc_queue_init(&loader->requests, ASSET_LOADER_QUEUE_SIZE) ||
+		!mpmc_queue_init(&loader->done, ASSET_LOADER_QUEUE_SIZE))
+		return false;
+
+	loader->wake = SDL_CreateSemaphore(0);
+	if (!loader->wake) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create loader semaphore: %s\n", SDL_GetError());
+		return false;
+	}
+
+	for (int i = 0; i < worker_count; ++i) {
+		loader->workers[i] = SDL_CreateThread(worker_main, "asset_loader", loader);
+		if (!loader->workers[i]) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create loader thread: %s\n", SDL_GetError());
+			return false;
+		}
+		loader->worker_count++;
+	}
+	SDL_Log("Asset loader started with %d workers\n", loader->worker_count);
+	return true;
+}
+
+void asset_loader_destroy(asset_loader_t *loader) {
+	// No read completes after this, unread files come back as failed jobs
+	atomic_store(&loader->quit, true);
+	asset_io_stop(&loader->io);
+	for (int i = 0; i < loader->worker_count; ++i)
+		SDL_SemPost(loader->wake);
+	for (int i = 0; i < loader->worker_count; ++i)
+		SDL_WaitThread(loader->workers[i], NULL);
+
+	// Drop whatever was never handed back
+	void *item;
+	if (loader->requests.cells)
+		while (mpmc_queue_pop(&loader->requests, &item))
+			free_job(item);
+	if (loader->done.cells)
+		while (mpmc_queue_pop(&loader->done, &item))
+			free_job(item);
+
+	mpmc_queue_destroy(&loader->requests);
+	mpmc_queue_destroy(&loader->done);
+	asset_io_destroy(&loader->io);
+	if (loader->wake)
+		SDL_DestroySemaphore(loader->wake);
+	*loader = (asset_loader_t){0};
+}
+
+// Runs on an I/O thread once the file is in memory, the decoders take it from there
+static void on_read(void *userdata, SDL_RWops *rw) {
+	asset_job_t *job = userdata;
+	asset_loader_t *loader = job->loader;
+	job->rw = rw;
+
+	while (!mpmc_queue_push(&loader->requests, job)) {
+		if (atomic_load(&loader->quit)) {
+			free_job(job);
+			return;
+		}
+		SDL_Delay(1);
+	}
+	SDL_SemPost(loader->wake);
+}
+
+bool asset_loader_request(asset_loader_t *loader, const char *path, asset_loaded_fn callback, void *userdata, int tag) {
+	asset_job_t *job = malloc(sizeof(asset_job_t));
+	char *path_copy = malloc(strlen(path) + 1);
+	if (!job || !path_copy) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to request %s.\n", path);
+		free(job);
+		free(path_copy);
+		return false;
+	}
+	strcpy(path_copy, path);
+	*job = (asset_job_t){
+		.loader = loader,
+		.path = path_copy,
+		.callback = callback,
+		.userdata = userdata,
+		.tag = tag,
+	};
+
+	// Reads of many requests are batched by the I/O layer
+	atomic_fetch_add(&loader->pending, 1);
+	if (!asset_io_read(&loader->io, path, on_read, job)) {
+		atomic_fetch_sub(&loader->pending, 1);
+		free_job(job);
+		return false;
+	}
+	return true;
+}
+
+int asset_loader_pump(asset_loader_t *loader, float budget_ms) {
+	const uint64_t start = SDL_GetPerformanceCounter();
+	const uint64_t budget = (uint64_t)(budget_ms * SDL_GetPerformanceFrequency() / 1000.0f);
+	int count = 0;
+
+	void *item;
+	while (SDL_GetPerformanceCounter() - start <= budget && mpmc_queue_pop(&loader->done, &item)) {
+		asset_job_t *job = item;
+		job->callback(job->userdata, job->tag, job->surface);
+		job->surface = NULL;			// Callback owns it now
+		free_job(job);
+		atomic_fetch_sub(&loader->pending, 1);
+		count++;
+	}
+	return count;
+}
+
+int asset_loader_pending(asset_loader_t *loader) {
+	return atomic_load(&loader->pending);
+}
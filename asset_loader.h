@@ -0,0 +1,40 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include <SDL.h>
+
+#include "asset_io.h"
+#include "mpmc_queue.h"
+
+#define ASSET_LOADER_MAX_WORKERS 8
+#define ASSET_LOADER_QUEUE_SIZE 256
+
+// Called on the render thread once an asset is decoded, takes ownership of the surface (NULL on failure)
+typedef void (*asset_loaded_fn)(void *userdata, int tag, SDL_Surface *surface);
+
+// Reads and decodes images on worker threads, the render thread only uploads them
+typedef struct {
+	asset_io_t io;						// Reads files, completions are queued for the decoders
+	SDL_Thread *workers[ASSET_LOADER_MAX_WORKERS];
+	int worker_count;
+	SDL_sem *wake;						// Posted once per request, workers sleep on it
+	atomic_bool quit;
+	atomic_int pending;					// Requests not yet handed back through asset_loader_pump
+	mpmc_queue_t requests;				// Files read and waiting to be decoded
+	mpmc_queue_t done;					// Decoded surfaces waiting to be uploaded
+} asset_loader_t;
+
+bool asset_loader_init(asset_loader_t *loader, int worker_count);
+void asset_loader_destroy(asset_loader_t *loader);
+
+// Queues a file for decoding, the callback runs later from asset_loader_pump
+bool asset_loader_request(asset_loader_t *loader, const char *path, asset_loaded_fn callback, void *userdata, int tag);
+
+// Runs callbacks of decoded assets until the time budget is spent, returns how many ran
+int asset_loader_pump(asset_loader_t *loader, float budget_ms);
+int asset_loader_pending(asset_loader_t *loader);
+
+#endif // ASSET_LOADER_H
@@ -0,0 +1,93 @@
+#include "atlas.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool atlas_load_pack(atlas_t *atlas, texture_cache_t *cache, const spk_pack_t *pack, const char *key) {
+	const spk_header_t *header = pack->header;
+	*atlas = (atlas_t){.texture = TEXTURE_NONE};
+
+	atlas->sheets = calloc(header->sheet_count, sizeof(atlas_sheet_t));
+	atlas->frames = calloc(header->frame_count, sizeof(atlas_frame_t));
+	if (!atlas->sheets || !atlas->frames) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for %u atlas frames.\n", header->frame_count);
+		goto fail;
+	}
+
+	for (uint32_t i = 0; i < header->sheet_count; ++i) {
+		const spk_sheet_t *packed = &pack->sheets[i];
+		atlas_sheet_t *sheet = &atlas->sheets[i];
+		*sheet = (atlas_sheet_t){
+			.w = (int)packed->w,
+			.h = (int)packed->h,
+			.frame_w = (int)packed->frame_w,
+			.frame_h = (int)packed->frame_h,
+			.columns = (int)(packed->w / packed->frame_w),
+			.first_frame = (int)packed->first_frame,
+			.frame_count = (int)packed->frame_count,
+		};
+		memcpy(sheet->name, packed->name, SPK_NAME_SIZE);
+		sheet->name[SPK_NAME_SIZE - 1] = '\0';
+	}
+	for (uint32_t i = 0; i < header->frame_count; ++i) {
+		const spk_frame_t *trimmed = &pack->frames[i];
+		atlas->frames[i] = (atlas_frame_t){
+			.src = {trimmed->x, trimmed->y, trimmed->w, trimmed->h},
+			.offset_x = trimmed->offset_x,
+			.offset_y = trimmed->offset_y,
+		};
+	}
+	atlas->sheet_count = (int)header->sheet_count;
+	atlas->frame_count = (int)header->frame_count;
+
+	// A pack loaded again shares the texture uploaded the first time
+	atlas->texture = texture_cache_acquire(cache, key);
+	if (atlas->texture == TEXTURE_NONE) {
+		SDL_Texture *texture = spk_upload(pack, cache->renderer);
+		if (!texture)
+			goto fail;
+		atlas->texture = texture_cache_insert(cache, key, texture);
+		if (atlas->texture == TEXTURE_NONE) {
+			SDL_DestroyTexture(texture);
+			goto fail;
+		}
+	}
+
+	atlas->width = (int)header->width;
+	atlas->height = (int)header->height;
+	SDL_Log("Atlas of %d sheets (%dx%d) uploaded from sprite pack\n", atlas->sheet_count, atlas->width, atlas->height);
+	return true;
+
+fail:
+	free(atlas->sheets);
+	free(atlas->frames);
+	*atlas = (atlas_t){.texture = TEXTURE_NONE};
+	return false;
+}
+
+void atlas_destroy(atlas_t *atlas, texture_cache_t *cache) {
+	free(atlas->sheets);
+	free(atlas->frames);
+	texture_cache_release(cache, atlas->texture);
+	*atlas = (atlas_t){.texture = TEXTURE_NONE};
+}
+
+int atlas_find_sheet(const atlas_t *atlas, const char *path) {
+	// Sheets are stored under the base name of their source image
+	const char *base = strrchr(path, '/');
+	base = base ? base + 1 : path;
+	size_t len = strcspn(base, ".");
+
+	for (int i = 0; i < atlas->sheet_count; ++i)
+		if (strlen(atlas->sheets[i].name) == len && strncmp(atlas->sheets[i].name, base, len) == 0)
+			return i;
+	return -1;
+}
+
+const atlas_frame_t *atlas_frame(const atlas_t *atlas, int sheet, int column, int row) {
+	const atlas_sheet_t *info = &atlas->sheets[sheet];
+	int frame = row * info->columns + column;
+	if (frame < 0 || frame >= info->frame_count)
+		return NULL;
+	return &atlas->frames[info->first_frame + frame];
+}
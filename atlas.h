@@ -0,0 +1,46 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+#include "spritepack.h"
+#include "texture_cache.h"
+
+// Where one animation frame lives in the atlas texture
+typedef struct {
+	SDL_Rect src;							// Trimmed region in the atlas texture, empty for a fully transparent frame
+	int offset_x, offset_y;					// Position of the trimmed region inside the untrimmed frame
+} atlas_frame_t;
+
+// Sheet as drawn by the artist: a grid of equally sized frames
+typedef struct {
+	char name[SPK_NAME_SIZE];				// Base name of the source image
+	int w, h;								// Untrimmed size of the sheet
+	int frame_w, frame_h;					// Untrimmed size of one frame
+	int columns;
+	int first_frame, frame_count;			// Frames of the sheet in the atlas frame table, row by row
+} atlas_sheet_t;
+
+// One texture holding the trimmed frames of every sheet of a sprite pack
+typedef struct {
+	int texture;							// Cached texture id shared by every sheet
+	atlas_sheet_t *sheets;
+	int sheet_count;
+	atlas_frame_t *frames;					// Frame table of every sheet
+	int frame_count;
+	int width, height;						// Size of the whole atlas texture
+} atlas_t;
+
+// Uploads a sprite pack into a single texture cached under the given key, usually the path of the pack
+bool atlas_load_pack(atlas_t *atlas, texture_cache_t *cache, const spk_pack_t *pack, const char *key);
+void atlas_destroy(atlas_t *atlas, texture_cache_t *cache);
+
+// Sheet made from the image at the given path, -1 when it is not in the atlas
+int atlas_find_sheet(const atlas_t *atlas, const char *path);
+
+// Frame at the given cell of a sheet grid
+const atlas_frame_t *atlas_frame(const atlas_t *atlas, int sheet, int column, int row);
+
+#endif // ATLAS_H
@@ -0,0 +1,447 @@
+#include "atlas_pages.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PADDING 1						// Gap between images so filtering never reads a neighbour
+
+static bool grow(void **array, int *capacity, int count, size_t item_size) {
+	if (count < *capacity)
+		return true;
+	int new_capacity = *capacity ? *capacity * 2 : 16;
+	void *items = realloc(*array, item_size * new_capacity);
+	if (!items) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to grow atlas pages.\n");
+		return false;
+	}
+	*array = items;
+	*capacity = new_capacity;
+	return true;
+}
+
+static void reset_page(atlas_page_t *page, int size) {
+	page->skyline[0] = (skyline_node_t){0, 0, size};
+	page->node_count = 1;
+	page->hole_count = 0;
+	page->used_area = 0;
+}
+
+// The texture of a page closed under this serial stays cached until evicted
+static void spare_serial(atlas_pages_t *pages, int serial) {
+	if (grow((void **)&pages->spare_serials, &pages->spare_capacity, pages->spare_count, sizeof(int)))
+		pages->spare_serials[pages->spare_count++] = serial;
+}
+
+static int open_page(atlas_pages_t *pages) {
+	if (!grow((void **)&pages->pages, &pages->page_capacity, pages->page_count, sizeof(atlas_page_t)))
+		return -1;
+
+	// The texture of a closed page is taken back when the cache still has it
+	atlas_page_t page = {.serial = pages->spare_count ? pages->spare_serials[--pages->spare_count] : pages->page_serial++};
+	char key[32];
+	snprintf(key, sizeof(key), "atlas_page:%d", page.serial);
+	page.texture = texture_cache_acquire(pages->cache, key);
+
+	SDL_Renderer *renderer = pages->cache->renderer;
+	SDL_Texture *texture = texture_cache_get(pages->cache, page.texture);
+	if (!texture) {
+		int access = pages->target_pages ? SDL_TEXTUREACCESS_TARGET : SDL_TEXTUREACCESS_STATIC;
+		texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, access, pages->page_size, pages->page_size);
+		if (!texture) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create atlas page: %s\n", SDL_GetError());
+			spare_serial(pages, page.serial);
+			return -1;
+		}
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		page.texture = texture_cache_insert(pages->cache, key, texture);
+		if (page.texture == TEXTURE_NONE)
+			SDL_DestroyTexture(texture);
+	}
+
+	if (page.texture != TEXTURE_NONE && pages->target_pages) {
+		// Start fully transparent, the padding around images is sampled by linear filtering
+		SDL_Texture *target = SDL_GetRenderTarget(renderer);
+		uint8_t r, g, b, a;
+		SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+		SDL_SetRenderTarget(renderer, texture);
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+		SDL_RenderClear(renderer);
+		SDL_SetRenderDrawColor(renderer, r, g, b, a);
+		SDL_SetRenderTarget(renderer, target);
+	}
+
+	page.skyline = malloc(sizeof(skyline_node_t) * 16);
+	page.node_capacity = 16;
+	if (page.texture == TEXTURE_NONE || !page.skyline) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not register atlas page.\n");
+		texture_cache_release(pages->cache, page.texture);
+		spare_serial(pages, page.serial);
+		free(page.skyline);
+		return -1;
+	}
+	reset_page(&page, pages->page_size);
+
+	pages->pages[pages->page_count] = page;
+	SDL_Log("Opened atlas page %d (%dx%d)\n", pages->page_count, pages->page_size, pages->page_size);
+	return pages->page_count++;
+}
+
+static void close_page(atlas_pages_t *pages, atlas_page_t *page) {
+	texture_cache_release(pages->cache, page->texture);
+	spare_serial(pages, page->serial);
+	free(page->skyline);
+	free(page->holes);
+	*page = (atlas_page_t){.texture = TEXTURE_NONE};
+}
+
+// Lowest y at which a w x h rect fits when its left edge is on the given node, -1 if it does not fit
+static int skyline_fit(const atlas_page_t *page, int size, int index, int w, int h) {
+	int x = page->skyline[index].x;
+	if (x + w > size)
+		return -1;
+
+	int y = 0;
+	for (int i = index, width_left = w; width_left > 0; width_left -= page->skyline[i++].w) {
+		y = SDL_max(y, page->skyline[i].y);
+		if (y + h > size)
+			return -1;
+	}
+	return y;
+}
+
+static bool skyline_place(atlas_page_t *page, int index, SDL_Rect rect) {
+	if (!grow((void **)&page->skyline, &page->node_capacity, page->node_count, sizeof(skyline_node_t)))
+		return false;
+
+	memmove(&page->skyline[index + 1], &page->skyline[index], sizeof(skyline_node_t) * (page->node_count - index));
+	page->skyline[index] = (skyline_node_t){rect.x, rect.y + rect.h, rect.w};
+	page->node_count++;
+
+	// Cut the nodes now below the new one
+	for (int i = index + 1; i < page->node_count; ) {
+		skyline_node_t *prev = &page->skyline[i - 1], *node = &page->skyline[i];
+		int shrink = prev->x + prev->w - node->x;
+		if (shrink <= 0)
+			break;
+		node->x += shrink;
+		node->w -= shrink;
+		if (node->w > 0)
+			break;
+		memmove(node, node + 1, sizeof(skyline_node_t) * (page->node_count - i - 1));
+		page->node_count--;
+	}
+
+	// Merge neighbours at the same height
+	for (int i = 0; i + 1 < page->node_count; ) {
+		if (page->skyline[i].y == page->skyline[i + 1].y) {
+			page->skyline[i].w += page->skyline[i + 1].w;
+			memmove(&page->skyline[i + 1], &page->skyline[i + 2], sizeof(skyline_node_t) * (page->node_count - i - 2));
+			page->node_count--;
+		} else {
+			++i;
+		}
+	}
+	return true;
+}
+
+// Takes the smallest hole that fits and gives back what is left on its right and below
+static bool hole_alloc(atlas_page_t *page, int w, int h, SDL_Rect *rect) {
+	int best = -1;
+	for (int i = 0; i < page->hole_count; ++i) {
+		const SDL_Rect *hole = &page->holes[i];
+		if (w <= hole->w && h <= hole->h && (best < 0 || hole->w * hole->h < page->holes[best].w * page->holes[best].h))
+			best = i;
+	}
+	if (best < 0)
+		return false;
+
+	SDL_Rect hole = page->holes[best];
+	page->holes[best] = page->holes[--page->hole_count];
+	*rect = (SDL_Rect){hole.x, hole.y, w, h};
+
+	// At most one of the pieces needs a new slot, the other reuses the taken one
+	if (hole.w > w)
+		page->holes[page->hole_count++] = (SDL_Rect){hole.x + w, hole.y, hole.w - w, h};
+	if (hole.h > h && grow((void **)&page->holes, &page->hole_capacity, page->hole_count, sizeof(SDL_Rect)))
+		page->holes[page->hole_count++] = (SDL_Rect){hole.x, hole.y + h, hole.w, hole.h - h};
+	return true;
+}
+
+static bool page_alloc(atlas_page_t *page, int size, int w, int h, SDL_Rect *rect) {
+	if (hole_alloc(page, w, h, rect))
+		return true;
+
+	// Bottom-left: lowest top edge, then narrowest node
+	int best = -1, best_top = size + 1, best_width = size + 1, best_y = 0;
+	for (int i = 0; i < page->node_count; ++i) {
+		int y = skyline_fit(page, size, i, w, h);
+		if (y < 0)
+			continue;
+		if (y + h < best_top || (y + h == best_top && page->skyline[i].w < best_width)) {
+			best = i;
+			best_top = y + h;
+			best_width = page->skyline[i].w;
+			best_y = y;
+		}
+	}
+	if (best < 0)
+		return false;
+
+	*rect = (SDL_Rect){page->skyline[best].x, best_y, w, h};
+	return skyline_place(page, best, *rect);
+}
+
+// Finds room in the open pages, opening a new one only when they are all full
+static bool alloc(atlas_pages_t *pages, int w, int h, int *page, SDL_Rect *rect) {
+	w += PADDING;
+	h += PADDING;
+	if (w > pages->page_size || h > pages->page_size) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Image of %dx%d is larger than an atlas page\n", w - PADDING, h - PADDING);
+		return false;
+	}
+
+	for (*page = 0; *page < pages->page_count; ++*page)
+		if (page_alloc(&pages->pages[*page], pages->page_size, w, h, rect))
+			break;
+	if (*page == pages->page_count) {
+		*page = open_page(pages);
+		if (*page < 0 || !page_alloc(&pages->pages[*page], pages->page_size, w, h, rect))
+			return false;
+	}
+
+	rect->w -= PADDING;
+	rect->h -= PADDING;
+	pages->pages[*page].live_regions++;
+	pages->pages[*page].used_area += w * h;
+	return true;
+}
+
+static int new_region(atlas_pages_t *pages) {
+	int id = pages->free_region;
+	if (id != ATLAS_REGION_NONE) {
+		pages->free_region = pages->regions[id].next_free;
+	} else {
+		if (!grow((void **)&pages->regions, &pages->region_capacity, pages->region_count, sizeof(atlas_region_t)))
+			return ATLAS_REGION_NONE;
+		id = pages->region_count++;
+	}
+	pages->regions[id] = (atlas_region_t){.page = -1, .live = true, .next_free = ATLAS_REGION_NONE};
+	return id;
+}
+
+static void recycle_region(atlas_pages_t *pages, int id) {
+	pages->regions[id] = (atlas_region_t){.page = -1, .next_free = pages->free_region};
+	pages->free_region = id;
+}
+
+static bool place(atlas_pages_t *pages, int id, SDL_Surface *surface) {
+	SDL_Surface *converted = surface;
+	if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+		converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+		if (!converted) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not convert image for the atlas: %s\n", SDL_GetError());
+			return false;
+		}
+	}
+
+	atlas_region_t *region = &pages->regions[id];
+	bool ok = alloc(pages, converted->w, converted->h, &region->page, &region->rect);
+	if (ok) {
+		// Only the sub-rect of the page is uploaded
+		SDL_Texture *texture = texture_cache_get(pages->cache, pages->pages[region->page].texture);
+		if (SDL_UpdateTexture(texture, &region->rect, converted->pixels, converted->pitch) != 0) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not upload image into atlas page: %s\n", SDL_GetError());
+			ok = false;
+		}
+	}
+	if (!ok)
+		region->page = -1;
+	if (converted != surface)
+		SDL_FreeSurface(converted);
+	return ok;
+}
+
+static void release_space(atlas_pages_t *pages, atlas_region_t *region) {
+	if (region->page < 0)
+		return;
+
+	atlas_page_t *page = &pages->pages[region->page];
+	SDL_Rect space = {region->rect.x, region->rect.y, region->rect.w + PADDING, region->rect.h + PADDING};
+	page->used_area -= space.w * space.h;
+	if (--page->live_regions == 0) {
+		// Empty page is reused from scratch
+		reset_page(page, pages->page_size);
+	} else if (grow((void **)&page->holes, &page->hole_capacity, page->hole_count, sizeof(SDL_Rect))) {
+		page->holes[page->hole_count++] = space;
+	}
+}
+
+bool atlas_pages_init(atlas_pages_t *pages, texture_cache_t *cache, int page_size) {
+	*pages = (atlas_pages_t){
+		.cache = cache,
+		.page_size = page_size,
+		.target_pages = SDL_RenderTargetSupported(cache->renderer),
+		.free_region = ATLAS_REGION_NONE,
+	};
+	if (!pages->target_pages)
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Renderer has no render targets, atlas pages cannot be defragmented\n");
+	return true;
+}
+
+void atlas_pages_destroy(atlas_pages_t *pages) {
+	for (int i = 0; i < pages->page_count; ++i)
+		close_page(pages, &pages->pages[i]);
+	free(pages->pages);
+	free(pages->regions);
+	free(pages->spare_serials);
+	*pages = (atlas_pages_t){0};
+}
+
+int atlas_pages_add(atlas_pages_t *pages, SDL_Surface *surface) {
+	int id = new_region(pages);
+	if (id == ATLAS_REGION_NONE)
+		return ATLAS_REGION_NONE;
+	if (!place(pages, id, surface)) {
+		recycle_region(pages, id);
+		return ATLAS_REGION_NONE;
+	}
+	return id;
+}
+
+static void on_image_loaded(void *userdata, int id, SDL_Surface *surface) {
+	atlas_pages_t *pages = userdata;
+	atlas_region_t *region = &pages->regions[id];
+
+	--region->loads;
+	if (!region->live) {
+		if (region->loads == 0)
+			recycle_region(pages, id);		// Freed while loading
+	} else if (!surface || !place(pages, id, surface)) {
+		region->failed = true;
+	} else if (pages->on_loaded) {
+		pages->on_loaded(pages->on_loaded_userdata, id, surface);
+	}
+	SDL_FreeSurface(surface);
+}
+
+int atlas_pages_add_async(atlas_pages_t *pages, asset_loader_t *loader, const char *path) {
+	int id = new_region(pages);
+	if (id == ATLAS_REGION_NONE)
+		return ATLAS_REGION_NONE;
+
+	pages->regions[id].loads = 1;
+	if (!asset_loader_request(loader, path, on_image_loaded, pages, id)) {
+		recycle_region(pages, id);
+		return ATLAS_REGION_NONE;
+	}
+	return id;
+}
+
+void atlas_pages_free(atlas_pages_t *pages, int id) {
+	if (id == ATLAS_REGION_NONE || !pages->regions[id].live)
+		return;
+
+	atlas_region_t *region = &pages->regions[id];
+	release_space(pages, region);
+	region->live = false;
+	region->page = -1;
+	if (region->loads == 0)
+		recycle_region(pages, id);
+}
+
+bool atlas_pages_failed(const atlas_pages_t *pages, int id) {
+	return id != ATLAS_REGION_NONE && pages->regions[id].failed;
+}
+
+int atlas_pages_texture(const atlas_pages_t *pages, int id, SDL_Rect *rect) {
+	if (id == ATLAS_REGION_NONE || pages->regions[id].page < 0)
+		return TEXTURE_NONE;
+	*rect = pages->regions[id].rect;
+	return pages->pages[pages->regions[id].page].texture;
+}
+
+bool atlas_pages_fragmented(const atlas_pages_t *pages) {
+	if (!pages->target_pages || pages->page_count < 2)
+		return false;
+	int64_t used = 0;
+	for (int i = 0; i < pages->page_count; ++i)
+		used += pages->pages[i].used_area;
+	// Packing from scratch leaves gaps too, only repack when a page less would be at most half full
+	return used * 2 <= (int64_t)(pages->page_count - 1) * pages->page_size * pages->page_size;
+}
+
+static const atlas_region_t *sort_regions;
+
+static int compare_heights(const void *a, const void *b) {
+	// Tallest first packs the skyline tightest
+	return sort_regions[*(const int *)b].rect.h - sort_regions[*(const int *)a].rect.h;
+}
+
+bool atlas_pages_defragment(atlas_pages_t *pages) {
+	if (!pages->target_pages)
+		return false;
+
+	int *order = malloc(sizeof(int) * (pages->region_count + 1));
+	atlas_region_t *moved = malloc(sizeof(atlas_region_t) * (pages->region_count + 1));
+	if (!order || !moved) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to defragment atlas pages.\n");
+		free(order);
+		free(moved);
+		return false;
+	}
+
+	int live = 0;
+	for (int i = 0; i < pages->region_count; ++i)
+		if (pages->regions[i].live && pages->regions[i].page >= 0)
+			order[live++] = i;
+	sort_regions = pages->regions;
+	qsort(order, (size_t)live, sizeof(int), compare_heights);
+
+	// Pack into fresh pages, old ones stay untouched until everything is copied
+	atlas_page_t *old_pages = pages->pages;
+	int old_count = pages->page_count, old_capacity = pages->page_capacity;
+	pages->pages = NULL;
+	pages->page_count = pages->page_capacity = 0;
+
+	SDL_Renderer *renderer = pages->cache->renderer;
+	SDL_Texture *target = SDL_GetRenderTarget(renderer);
+	bool ok = true;
+	for (int i = 0; i < live && ok; ++i) {
+		const atlas_region_t *region = &pages->regions[order[i]];
+		moved[i] = *region;
+		ok = alloc(pages, region->rect.w, region->rect.h, &moved[i].page, &moved[i].rect);
+		if (!ok)
+			break;
+
+		// Copy on the graphics card, alpha included
+		SDL_Texture *src = texture_cache_get(pages->cache, old_pages[region->page].texture);
+		SDL_Texture *dst = texture_cache_get(pages->cache, pages->pages[moved[i].page].texture);
+		SDL_SetTextureBlendMode(src, SDL_BLENDMODE_NONE);
+		ok = SDL_SetRenderTarget(renderer, dst) == 0 && SDL_RenderCopy(renderer, src, &region->rect, &moved[i].rect) == 0;
+		SDL_SetTextureBlendMode(src, SDL_BLENDMODE_BLEND);
+		if (!ok)
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not copy region during defragmentation: %s\n", SDL_GetError());
+	}
+	SDL_SetRenderTarget(renderer, target);
+
+	// Keep whichever set of pages is complete
+	atlas_page_t *drop = ok ? old_pages : pages->pages;
+	int drop_count = ok ? old_count : pages->page_count;
+	for (int i = 0; i < drop_count; ++i)
+		close_page(pages, &drop[i]);
+	free(drop);
+	if (ok) {
+		for (int i = 0; i < live; ++i)
+			pages->regions[order[i]] = moved[i];
+		SDL_Log("Defragmented %d regions from %d into %d atlas pages\n", live, old_count, pages->page_count);
+	} else {
+		pages->pages = old_pages;
+		pages->page_count = old_count;
+		pages->page_capacity = old_capacity;
+	}
+
+	free(order);
+	free(moved);
+	return ok;
+}
@@ -0,0 +1,79 @@
+#ifndef ATLAS_PAGES_H
+#define ATLAS_PAGES_H
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+#include "asset_loader.h"
+#include "texture_cache.h"
+
+#define ATLAS_PAGE_SIZE 2048
+#define ATLAS_REGION_NONE (-1)
+
+typedef struct {
+	int x, y, w;						// Segment of the skyline: top edge of the used space
+} skyline_node_t;
+
+// One texture sub-allocated with a skyline packer
+typedef struct {
+	int texture;						// Cached texture id
+	int serial;							// Names the texture in the cache
+	skyline_node_t *skyline;			// Sorted by x, covers the whole page width
+	int node_count, node_capacity;
+	SDL_Rect *holes;					// Space given back by freed regions, reused before the skyline
+	int hole_count, hole_capacity;
+	int live_regions;
+	int used_area;
+} atlas_page_t;
+
+typedef struct {
+	int page;							// -1 while the image is loading or when the region is free
+	SDL_Rect rect;						// Position inside the page
+	bool live;							// Region id is handed out
+	int loads;							// Requests waiting for the loader, the id is not reused before they answer
+	bool failed;						// Image could not be decoded or placed, the region never gets a page
+	int next_free;						// Next free region id
+} atlas_region_t;
+
+// Sees every image of the loader once it is in its region, before its surface is freed
+typedef void (*atlas_loaded_fn)(void *userdata, int region, const SDL_Surface *surface);
+
+// Atlas pages shared by every sprite loaded at runtime, a new page is opened only when the others are full
+typedef struct {
+	texture_cache_t *cache;
+	int page_size;
+	bool target_pages;					// Pages can be render targets, needed to defragment
+	atlas_page_t *pages;
+	int page_count, page_capacity;
+	atlas_region_t *regions;			// Region ids stay valid when regions move between pages
+	int region_count, region_capacity;
+	int free_region;					// Head of the free region list
+	int page_serial;					// Makes cache keys of pages unique
+	int *spare_serials;					// Serials of closed pages, their textures stay cached until evicted
+	int spare_count, spare_capacity;
+	atlas_loaded_fn on_loaded;			// Optional, set by the owner
+	void *on_loaded_userdata;
+} atlas_pages_t;
+
+bool atlas_pages_init(atlas_pages_t *pages, texture_cache_t *cache, int page_size);
+void atlas_pages_destroy(atlas_pages_t *pages);
+
+// Copies an image into a page, returns its region id
+int atlas_pages_add(atlas_pages_t *pages, SDL_Surface *surface);
+// Decodes an image on the loader threads, the region has no page until it is uploaded
+int atlas_pages_add_async(atlas_pages_t *pages, asset_loader_t *loader, const char *path);
+// Gives the space of a region back to its page, a region still loading is dropped once its image arrives
+void atlas_pages_free(atlas_pages_t *pages, int region);
+
+// True once the image of a region could not be decoded or placed, free the region and ask again
+bool atlas_pages_failed(const atlas_pages_t *pages, int region);
+// Cached texture id of the page of a region and the rect inside it, TEXTURE_NONE while it is loading
+int atlas_pages_texture(const atlas_pages_t *pages, int region, SDL_Rect *rect);
+
+// Freed regions leave holes: true once the live ones would fit in fewer pages
+bool atlas_pages_fragmented(const atlas_pages_t *pages);
+// Repacks every live region into as few pages as possible and drops the old pages, texture ids of regions change
+bool atlas_pages_defragment(atlas_pages_t *pages);
+
+#endif // ATLAS_PAGES_H
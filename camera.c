@@ -0,0 +1,114 @@
+#include "camera.h"
+
+void camera_init(camera_t *camera, float world_w, float world_h, float view_w, float view_h) {
+	*camera = (camera_t){.zoom = 1.0f, .world_w = world_w, .world_h = world_h};
+	camera_resize(camera, view_w, view_h);
+}
+
+// Keeps the view inside the world on each axis, or centres the world when it is smaller than the view
+static float clamp_axis(float start, float view, float world) {
+	if (view >= world)
+		return (world - view) * 0.5f;
+	return SDL_min(SDL_max(start, 0.0f), world - view);
+}
+
+static void clamp(camera_t *camera) {
+	camera->x = clamp_axis(camera->x, camera->view_w / camera->zoom, camera->world_w);
+	camera->y = clamp_axis(camera->y, camera->view_h / camera->zoom, camera->world_h);
+}
+
+void camera_resize(camera_t *camera, float view_w, float view_h) {
+	camera->view_w = view_w;
+	camera->view_h = view_h;
+	clamp(camera);
+}
+
+void camera_set_zoom(camera_t *camera, float zoom) {
+	zoom = SDL_min(SDL_max(zoom, CAMERA_MIN_ZOOM), CAMERA_MAX_ZOOM);
+	float centre_x = camera->x + camera->view_w * 0.5f / camera->zoom;
+	float centre_y = camera->y + camera->view_h * 0.5f / camera->zoom;
+	camera->zoom = zoom;
+	camera_follow(camera, centre_x, centre_y);
+}
+
+void camera_follow(camera_t *camera, float x, float y) {
+	camera->x = x - camera->view_w * 0.5f / camera->zoom;
+	camera->y = y - camera->view_h * 0.5f / camera->zoom;
+	clamp(camera);
+}
+
+SDL_FRect camera_view(const camera_t *camera) {
+	return (SDL_FRect){camera->x, camera->y, camera->view_w / camera->zoom, camera->view_h / camera->zoom};
+}
+
+SDL_FRect camera_to_screen(const camera_t *camera, const SDL_FRect *rect) {
+	return (SDL_FRect){
+		(rect->x - camera->x) * camera->zoom,
+		(rect->y - camera->y) * camera->zoom,
+		rect->w * camera->zoom,
+		rect->h * camera->zoom,
+	};
+}
+
+int camera_cull_scalar(const float *position, const float *extent, int count, const float view[4], int *visible) {
+	int n = 0;
+	for (int i = 0; i < count; ++i) {
+		const float x = position[i * 2], y = position[i * 2 + 1];
+		visible[n] = i;
+		n += x <= view[2] && y <= view[3] && x + extent[i * 2] >= view[0] && y + extent[i * 2 + 1] >= view[1];
+	}
+	return n;
+}
+
+#ifdef SIMD_X86
+// x and y alternate in the arrays, so a box is two adjacent lanes and is visible when both pass.
+// Indices are written without a branch, the slot of a hidden box is overwritten by the next one.
+
+// Boxes from first on that do not fill a vector
+static int cull_tail(const float *position, const float *extent, int first, int count, const float view[4], int *visible) {
+	int n = camera_cull_scalar(position + first * 2, extent + first * 2, count - first, view, visible);
+	for (int k = 0; k < n; ++k)
+		visible[k] += first;
+	return n;
+}
+
+#ifdef SIMD_SSE2
+static int camera_cull_sse2(const float *position, const float *extent, int count, const float view[4], int *visible) {
+	const __m128 start = _mm_setr_ps(view[0], view[1], view[0], view[1]);
+	const __m128 end = _mm_setr_ps(view[2], view[3], view[2], view[3]);
+	int n = 0, i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128 p = _mm_loadu_ps(position + i * 2);
+		__m128 inside = _mm_and_ps(_mm_cmple_ps(p, end), _mm_cmpge_ps(_mm_add_ps(p, _mm_loadu_ps(extent + i * 2)), start));
+		int lanes = _mm_movemask_ps(inside);
+		visible[n] = i;
+		n += (lanes & 0x3) == 0x3;
+		visible[n] = i + 1;
+		n += (lanes & 0xC) == 0xC;
+	}
+	return n + cull_tail(position, extent, i, count, view, visible + n);
+}
+#endif
+
+#ifdef SIMD_AVX2
+SIMD_TARGET_AVX2
+static int camera_cull_avx2(const float *position, const float *extent, int count, const float view[4], int *visible) {
+	const __m256 start = _mm256_setr_ps(view[0], view[1], view[0], view[1], view[0], view[1], view[0], view[1]);
+	const __m256 end = _mm256_setr_ps(view[2], view[3], view[2], view[3], view[2], view[3], view[2], view[3]);
+	int n = 0, i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256 p = _mm256_loadu_ps(position + i * 2);
+		__m256 inside = _mm256_and_ps(_mm256_cmp_ps(p, end, _CMP_LE_OQ),
+									  _mm256_cmp_ps(_mm256_add_ps(p, _mm256_loadu_ps(extent + i * 2)), start, _CMP_GE_OQ));
+		int lanes = _mm256_movemask_ps(inside);
+		for (int k = 0; k < 4; ++k) {
+			visible[n] = i + k;
+			n += ((lanes >> (k * 2)) & 0x3) == 0x3;
+		}
+	}
+	return n + cull_tail(position, extent, i, count, view, visible + n);
+}
+#endif
+#endif // SIMD_X86
+
+SIMD_DEFINE(camera_cull, camera_cull_fn, camera_cull_scalar, camera_cull_sse2, camera_cull_avx2)
@@ -0,0 +1,41 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <SDL.h>
+
+#include "simd.h"
+
+#define CAMERA_MIN_ZOOM 0.125f
+#define CAMERA_MAX_ZOOM 8.0f
+
+// Part of the world shown in the window, screen = (world - top left) * zoom
+typedef struct {
+	float x, y;							// World point at the top left corner of the window
+	float zoom;							// Screen pixels per world pixel
+	float view_w, view_h;				// Window size in screen pixels
+	float world_w, world_h;				// The view stays inside the world, centred when the world is smaller
+} camera_t;
+
+void camera_init(camera_t *camera, float world_w, float world_h, float view_w, float view_h);
+void camera_resize(camera_t *camera, float view_w, float view_h);
+// Zoom is clamped to [CAMERA_MIN_ZOOM, CAMERA_MAX_ZOOM], the centre of the view stays in place
+void camera_set_zoom(camera_t *camera, float zoom);
+// Centres the view on a world point, as far as the world bounds allow
+void camera_follow(camera_t *camera, float x, float y);
+
+// World rect seen through the window
+SDL_FRect camera_view(const camera_t *camera);
+// World rect to screen rect
+SDL_FRect camera_to_screen(const camera_t *camera, const SDL_FRect *rect);
+
+// Writes the indices of the boxes that touch view (min x, min y, max x, max y) to visible, returns
+// how many there are. Arrays are {x, y} pairs of the top left corner and {w, h} of each box,
+// visible has room for count indices.
+typedef int (*camera_cull_fn)(const float *position, const float *extent, int count, const float view[4], int *visible);
+
+// Reference implementation, every other variant gives the same result
+int camera_cull_scalar(const float *position, const float *extent, int count, const float view[4], int *visible);
+
+SIMD_DECLARE(camera_cull, camera_cull_fn);
+
+#endif // CAMERA_H
@@ -0,0 +1,140 @@
+#include "collision_mask.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t *row_bits(const collision_mask_t *mask, int frame, int row) {
+	return mask->bits + ((size_t)frame * mask->frame_h + row) * mask->words;
+}
+
+bool collision_mask_init(collision_mask_t *mask, const anim_table_t *anims, int scale) {
+	*mask = (collision_mask_t){
+		.frame_w = anims->frame_w,
+		.frame_h = anims->frame_h,
+		.columns = anims->columns,
+		.rows = anims->rows,
+		.scale = scale,
+		.words = (anims->frame_w * scale + 63) / 64,
+	};
+	size_t words = (size_t)mask->columns * mask->rows * mask->frame_h * mask->words;
+	mask->bits = calloc(words, sizeof(uint64_t));
+	if (!mask->bits) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for a collision mask of %zu words.\n", words);
+		return false;
+	}
+	return true;
+}
+
+void collision_mask_destroy(collision_mask_t *mask) {
+	free(mask->bits);
+	*mask = (collision_mask_t){0};
+}
+
+bool collision_mask_add_frame(collision_mask_t *mask, int frame, const void *pixels, int pitch, uint32_t format,
+							  SDL_Rect src, int offset_x, int offset_y) {
+	SDL_PixelFormat *pixel_format = SDL_AllocFormat(format);
+	if (!pixel_format || pixel_format->BytesPerPixel != 4) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Collision masks need 32-bit pixels, not %s.\n", SDL_GetPixelFormatName(format));
+		SDL_FreeFormat(pixel_format);
+		return false;
+	}
+
+	for (int y = 0; y < src.h; ++y) {
+		int row = offset_y + y;
+		if (row < 0 || row >= mask->frame_h)
+			continue;
+		const uint32_t *line = (const uint32_t *)((const uint8_t *)pixels + (size_t)(src.y + y) * pitch) + src.x;
+		uint64_t *bits = row_bits(mask, frame, row);
+		for (int x = 0; x < src.w; ++x) {
+			int column = offset_x + x;
+			uint8_t r, g, b, a;
+			SDL_GetRGBA(line[x], pixel_format, &r, &g, &b, &a);
+			if (column < 0 || column >= mask->frame_w || a < COLLISION_ALPHA_THRESHOLD)
+				continue;
+			// One sheet pixel covers scale screen pixels across
+			for (int bit = column * mask->scale; bit < (column + 1) * mask->scale; ++bit)
+				bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+		}
+	}
+	SDL_FreeFormat(pixel_format);
+	return true;
+}
+
+bool collision_mask_from_surface(collision_mask_t *mask, const SDL_Surface *surface) {
+	memset(mask->bits, 0, sizeof(uint64_t) * mask->columns * mask->rows * mask->frame_h * mask->words);
+	for (int row = 0; row < mask->rows; ++row) {
+		for (int column = 0; column < mask->columns; ++column) {
+			SDL_Rect cell = {column * mask->frame_w, row * mask->frame_h, mask->frame_w, mask->frame_h};
+			SDL_Rect sheet = {0, 0, surface->w, surface->h};
+			SDL_Rect src;
+			if (!SDL_IntersectRect(&cell, &sheet, &src))
+				continue;
+			if (!collision_mask_add_frame(mask, row * mask->columns + column, surface->pixels, surface->pitch,
+										  surface->format->format, src, 0, 0))
+				return false;
+		}
+	}
+	mask->ready = true;
+	return true;
+}
+
+bool collision_mask_from_pack(collision_mask_t *mask, const spk_pack_t *pack, int sheet) {
+	const spk_sheet_t *packed = &pack->sheets[sheet];
+	int columns = (int)(packed->w / packed->frame_w);
+	memset(mask->bits, 0, sizeof(uint64_t) * mask->columns * mask->rows * mask->frame_h * mask->words);
+	for (int i = 0; i < (int)packed->frame_count; ++i) {
+		const spk_frame_t *frame = &pack->frames[packed->first_frame + i];
+		int column = i % columns, row = i / columns;
+		if (column >= mask->columns || row >= mask->rows || frame->w == 0)
+			continue;
+		SDL_Rect src = {frame->x, frame->y, frame->w, frame->h};
+		if (!collision_mask_add_frame(mask, row * mask->columns + column, pack->pixels, (int)pack->header->pitch,
+									  pack->header->pixel_format, src, frame->offset_x, frame->offset_y))
+			return false;
+	}
+	mask->ready = true;
+	return true;
+}
+
+int collision_mask_frame(const collision_mask_t *mask, const SDL_Rect *src) {
+	int frame = (src->y / mask->frame_h) * mask->columns + src->x / mask->frame_w;
+	return SDL_clamp(frame, 0, mask->columns * mask->rows - 1);
+}
+
+// 64 bits of a row starting at bit start, bits outside the row are clear
+static uint64_t window(const uint64_t *row, int words, int start) {
+	int word = start >= 0 ? start / 64 : -((63 - start) / 64);
+	int shift = start - word * 64;
+	uint64_t low = word >= 0 && word < words ? row[word] >> shift : 0;
+	uint64_t high = shift && word + 1 >= 0 && word + 1 < words ? row[word + 1] << (64 - shift) : 0;
+	return low | high;
+}
+
+bool collision_mask_overlap(const collision_mask_t *a, int frame_a, int ax, int ay,
+							const collision_mask_t *b, int frame_b, int bx, int by) {
+	int top = SDL_max(ay, by);
+	int bottom = SDL_min(ay + a->frame_h * a->scale, by + b->frame_h * b->scale);
+	int left = SDL_max(ax, bx);
+	int right = SDL_min(ax + a->frame_w * a->scale, bx + b->frame_w * b->scale);
+	if (top >= bottom || left >= right)
+		return false;
+	if (!a->ready || !b->ready)
+		return true;					// Sheet still loading, the rects are all we know
+
+	// Words of a covering the overlap on x, b is read at the same screen pixels
+	int first_word = (left - ax) / 64, last_word = (right - ax - 1) / 64;
+	int offset = ax - bx;
+
+	// Screen rows in runs where neither sprite changes sheet row
+	for (int y = top; y < bottom;) {
+		int row_a = (y - ay) / a->scale, row_b = (y - by) / b->scale;
+		const uint64_t *bits_a = row_bits(a, frame_a, row_a);
+		const uint64_t *bits_b = row_bits(b, frame_b, row_b);
+		for (int w = first_word; w <= last_word; ++w)
+			if (bits_a[w] & window(bits_b, b->words, w * 64 + offset))
+				return true;
+		int next_a = ay + (row_a + 1) * a->scale, next_b = by + (row_b + 1) * b->scale;
+		y = SDL_min(next_a, next_b);
+	}
+	return false;
+}
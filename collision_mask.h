@@ -0,0 +1,45 @@
+#ifndef COLLISION_MASK_H
+#define COLLISION_MASK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL.h>
+
+#include "anim.h"
+#include "spritepack.h"
+
+#define COLLISION_ALPHA_THRESHOLD 128	// Pixels at least this opaque collide
+
+// Opaque pixels of every frame of a sheet, one bit per screen pixel across and one row per sheet row.
+// Bit i of word w of a row is screen pixel 64 * w + i of the frame, already scaled.
+typedef struct {
+	int frame_w, frame_h;				// Untrimmed frame in sheet pixels
+	int columns, rows;					// Frame grid of the sheet
+	int scale;							// Screen pixels per sheet pixel
+	int words;							// 64-bit words per row
+	uint64_t *bits;						// Frames row by row, frame_h rows of words each
+	bool ready;							// Pixels were read, until then every frame is a full rect
+} collision_mask_t;
+
+// Empty mask for the frame grid of the table
+bool collision_mask_init(collision_mask_t *mask, const anim_table_t *anims, int scale);
+void collision_mask_destroy(collision_mask_t *mask);
+
+// Reads every frame of a whole sheet
+bool collision_mask_from_surface(collision_mask_t *mask, const SDL_Surface *surface);
+// Reads every trimmed frame of a sheet of a sprite pack
+bool collision_mask_from_pack(collision_mask_t *mask, const spk_pack_t *pack, int sheet);
+// Reads one trimmed frame: src inside the pixels, placed at offset inside the untrimmed frame.
+// The mask stays a full rect until one of the whole-sheet readers above is done.
+bool collision_mask_add_frame(collision_mask_t *mask, int frame, const void *pixels, int pitch, uint32_t format,
+							  SDL_Rect src, int offset_x, int offset_y);
+
+// Frame of the mask drawn from a source rect of the sheet
+int collision_mask_frame(const collision_mask_t *mask, const SDL_Rect *src);
+
+// True when opaque pixels of two frames drawn at the given screen positions overlap
+bool collision_mask_overlap(const collision_mask_t *a, int frame_a, int ax, int ay,
+							const collision_mask_t *b, int frame_b, int bx, int by);
+
+#endif // COLLISION_MASK_H
@@ -0,0 +1,84 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <stdint.h>
+
+#include <SDL.h>
+
+#include "anim.h"
+#include "ecs.h"
+
+typedef enum {
+	MOVING_DOWN,
+	MOVING_RIGHT,
+	MOVING_LEFT,
+	MOVING_UP,
+	IDLE,
+} actor_state_t;
+
+typedef struct {
+	float x, y;							// Top-left corner on screen
+} position_t;
+
+typedef struct {
+	float x, y;							// Pixels per second
+} velocity_t;
+
+typedef struct {
+	float w, h;							// Size on screen, follows position_t so kernels read both as pairs
+} extent_t;
+
+typedef struct {
+	float x, y;							// Velocity factor when an edge stops the actor: -1 turns it back, 0 stops it
+} bounce_t;
+
+typedef struct {
+	uint8_t state;						// actor_state_t
+	uint8_t facing;						// Last direction moved, picks the idle clip
+	uint8_t clip;						// anim_clip_id_t being played, its clock is the anim_timer_t
+} animation_t;
+
+typedef struct {
+	SDL_Rect rect;						// Frame on screen, relative to the sheet
+} source_t;
+
+typedef struct {
+	int species;						// Registry id, gives the texture, clips, speed and scale
+} sprite_t;
+
+typedef struct {
+	float left;							// Seconds until the wanderer leaves and another one walks in
+	uint32_t seed;						// Random state, handed down to the next wanderer
+} life_t;
+
+// Every component of the game: id, type.
+// PREVIOUS is the position before the last step, drawn blended with the current one.
+#define COMPONENTS(X) \
+	X(COMPONENT_POSITION,	position_t) \
+	X(COMPONENT_PREVIOUS,	position_t) \
+	X(COMPONENT_VELOCITY,	velocity_t) \
+	X(COMPONENT_EXTENT,		extent_t) \
+	X(COMPONENT_BOUNCE,		bounce_t) \
+	X(COMPONENT_ANIMATION,	animation_t) \
+	X(COMPONENT_TIMER,		anim_timer_t) \
+	X(COMPONENT_SOURCE,		source_t) \
+	X(COMPONENT_SPRITE,		sprite_t) \
+	X(COMPONENT_LIFE,		life_t)
+
+typedef enum {
+#define COMPONENT_ID(id, type) id,
+	COMPONENTS(COMPONENT_ID)
+#undef COMPONENT_ID
+	COMPONENT_COUNT,
+} component_id_t;
+
+// Components of an actor that walks around
+#define ACTOR_MASK (ECS_COMPONENT(COMPONENT_POSITION) | ECS_COMPONENT(COMPONENT_PREVIOUS) | \
+					ECS_COMPONENT(COMPONENT_VELOCITY) | ECS_COMPONENT(COMPONENT_EXTENT) | \
+					ECS_COMPONENT(COMPONENT_BOUNCE) | ECS_COMPONENT(COMPONENT_ANIMATION) | \
+					ECS_COMPONENT(COMPONENT_TIMER) | ECS_COMPONENT(COMPONENT_SOURCE) | \
+					ECS_COMPONENT(COMPONENT_SPRITE))
+// Actors walking on their own, replaced after a while
+#define WANDERER_MASK (ACTOR_MASK | ECS_COMPONENT(COMPONENT_LIFE))
+
+#endif // COMPONENTS_H
@@ -0,0 +1,151 @@
+#include "dirty_rects.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static bool resize(void **array, int capacity, size_t item_size) {
+	void *items = realloc(*array, item_size * capacity);
+	if (!items)
+		return false;
+	*array = items;
+	return true;
+}
+
+bool dirty_rects_init(dirty_rects_t *dirty) {
+	*dirty = (dirty_rects_t){.reset = true};
+	return true;
+}
+
+void dirty_rects_destroy(dirty_rects_t *dirty) {
+	free(dirty->previous);
+	free(dirty->current);
+	*dirty = (dirty_rects_t){0};
+}
+
+void dirty_rects_begin(dirty_rects_t *dirty, int width, int height) {
+	dirty->full = dirty->reset || dirty->screen.w != width || dirty->screen.h != height;
+	dirty->reset = false;
+	dirty->screen = (SDL_Rect){0, 0, width, height};
+	dirty->count = 0;
+	dirty->area = 0;
+}
+
+void dirty_rects_invalidate(dirty_rects_t *dirty) {
+	dirty->full = true;
+}
+
+void dirty_rects_add(dirty_rects_t *dirty, const SDL_FRect *rect) {
+	if (dirty->full)
+		return;
+
+	// Every pixel the sprite touches, even partly
+	int x = (int)SDL_floorf(rect->x), y = (int)SDL_floorf(rect->y);
+	SDL_Rect covered = {x, y, (int)SDL_ceilf(rect->x + rect->w) - x, (int)SDL_ceilf(rect->y + rect->h) - y};
+	if (!SDL_IntersectRect(&covered, &dirty->screen, &covered))
+		return;
+
+	// Overlapping rects become their union, which may overlap others again
+	for (int i = 0; i < dirty->count; ++i) {
+		if (SDL_HasIntersection(&covered, &dirty->rects[i])) {
+			SDL_UnionRect(&covered, &dirty->rects[i], &covered);
+			dirty->area -= (int64_t)dirty->rects[i].w * dirty->rects[i].h;
+			dirty->rects[i] = dirty->rects[--dirty->count];
+			i = -1;
+		}
+	}
+
+	dirty->area += (int64_t)covered.w * covered.h;
+	if (dirty->count == DIRTY_MAX_RECTS || dirty->area * 100 > (int64_t)dirty->screen.w * dirty->screen.h * DIRTY_MAX_PERCENT) {
+		dirty->full = true;
+		return;
+	}
+	dirty->rects[dirty->count++] = covered;
+}
+
+static uint64_t mix(uint64_t hash, uint32_t value) {
+	return (hash ^ value) * 0x100000001B3ull;
+}
+
+static uint32_t float_bits(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// Fields one at a time, the padding of an item is not set
+static uint64_t hash_item(const render_item_t *item) {
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash = mix(hash, (uint32_t)item->texture);
+	hash = mix(hash, item->whole ? 0xFFFFFFFFu : (uint32_t)(item->src.x | item->src.y << 16));
+	hash = mix(hash, (uint32_t)(item->src.w | item->src.h << 16));
+	hash = mix(hash, float_bits(item->dest.x));
+	hash = mix(hash, float_bits(item->dest.y));
+	hash = mix(hash, float_bits(item->dest.w));
+	hash = mix(hash, float_bits(item->dest.h));
+	hash = mix(hash, (uint32_t)item->tint.r | item->tint.g << 8 | item->tint.b << 16 | (uint32_t)item->tint.a << 24);
+	return mix(hash, (uint32_t)item->flip);
+}
+
+static bool same_item(const render_item_t *a, const render_item_t *b) {
+	return a->texture == b->texture && a->whole == b->whole && (a->whole || SDL_RectEquals(&a->src, &b->src)) &&
+		   a->dest.x == b->dest.x && a->dest.y == b->dest.y && a->dest.w == b->dest.w && a->dest.h == b->dest.h &&
+		   a->tint.r == b->tint.r && a->tint.g == b->tint.g && a->tint.b == b->tint.b && a->tint.a == b->tint.a &&
+		   a->flip == b->flip;
+}
+
+static int compare_hashes(const void *a, const void *b) {
+	uint64_t x = ((const dirty_sprite_t *)a)->hash, y = ((const dirty_sprite_t *)b)->hash;
+	return (x > y) - (x < y);
+}
+
+bool dirty_rects_diff(dirty_rects_t *dirty, const render_item_t *items, int count) {
+	if (count > dirty->sprite_capacity) {
+		int capacity = SDL_max(count, dirty->sprite_capacity * 2);
+		if (!resize((void **)&dirty->previous, capacity, sizeof(dirty_sprite_t)) ||
+			!resize((void **)&dirty->current, capacity, sizeof(dirty_sprite_t))) {
+			dirty->previous_count = 0;
+			dirty->reset = true;
+			dirty_rects_invalidate(dirty);
+			return false;
+		}
+		dirty->sprite_capacity = capacity;
+	}
+
+	dirty_sprite_t *current = dirty->current;
+	for (int i = 0; i < count; ++i)
+		current[i] = (dirty_sprite_t){hash_item(&items[i]), items[i]};
+	qsort(current, count, sizeof(dirty_sprite_t), compare_hashes);
+
+	// Both frames sorted by hash: sprites found in both are unchanged, the others are dirty.
+	// Different sprites with the same hash are both dirtied, which is only wasteful.
+	const dirty_sprite_t *previous = dirty->previous;
+	int i = 0, j = 0;
+	while (i < dirty->previous_count || j < count) {
+		if (j == count || (i < dirty->previous_count && previous[i].hash < current[j].hash)) {
+			dirty_rects_add(dirty, &previous[i++].item.dest);
+		} else if (i == dirty->previous_count || current[j].hash < previous[i].hash) {
+			dirty_rects_add(dirty, &current[j++].item.dest);
+		} else {
+			if (!same_item(&previous[i].item, &current[j].item)) {
+				dirty_rects_add(dirty, &previous[i].item.dest);
+				dirty_rects_add(dirty, &current[j].item.dest);
+			}
+			++i;
+			++j;
+		}
+	}
+
+	dirty->current = dirty->previous;
+	dirty->previous = current;
+	dirty->previous_count = count;
+	return true;
+}
+
+const SDL_Rect *dirty_rects_get(const dirty_rects_t *dirty, int *count) {
+	if (dirty->full) {
+		*count = 1;
+		return &dirty->screen;
+	}
+	*count = dirty->count;
+	return dirty->rects;
+}
@@ -0,0 +1,48 @@
+#ifndef DIRTY_RECTS_H
+#define DIRTY_RECTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL.h>
+
+#include "render_queue.h"
+
+#define DIRTY_MAX_RECTS 64					// More regions than this redraw the whole screen
+#define DIRTY_MAX_PERCENT 50				// So does a larger part of the screen, one pass is cheaper then
+
+// Sprite as drawn last frame
+typedef struct {
+	uint64_t hash;
+	render_item_t item;
+} dirty_sprite_t;
+
+// Parts of the screen that changed since the last frame. Sprites are compared by what they draw
+// (texture, source, destination...), not by who they are: a sprite drawn again unchanged costs nothing,
+// one that moved or changed frame dirties where it was and where it is.
+typedef struct {
+	SDL_Rect screen;
+	SDL_Rect rects[DIRTY_MAX_RECTS];		// Merged, none of them overlap
+	int count;
+	int64_t area;							// Pixels of the rects
+	bool full;								// The whole screen is redrawn
+	bool reset;								// Sprites of the last frame are unknown, the next one is redrawn whole
+	dirty_sprite_t *previous, *current;		// Sorted by hash
+	int previous_count, sprite_capacity;
+} dirty_rects_t;
+
+bool dirty_rects_init(dirty_rects_t *dirty);
+void dirty_rects_destroy(dirty_rects_t *dirty);
+
+// Starts a frame, everything is dirty on the first one and when the screen size changes
+void dirty_rects_begin(dirty_rects_t *dirty, int width, int height);
+// Everything is dirty this frame, for changes the sprites do not show (window exposed, pixels of a texture replaced)
+void dirty_rects_invalidate(dirty_rects_t *dirty);
+void dirty_rects_add(dirty_rects_t *dirty, const SDL_FRect *rect);
+// Dirties the sprites that appeared, disappeared or changed since the last call. False when out of memory,
+// the whole screen is dirty then.
+bool dirty_rects_diff(dirty_rects_t *dirty, const render_item_t *items, int count);
+// Regions to redraw and push to the window
+const SDL_Rect *dirty_rects_get(const dirty_rects_t *dirty, int *count);
+
+#endif // DIRTY_RECTS_H
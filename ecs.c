@@ -0,0 +1,470 @@
+#include "ecs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#define CHUNK_ALIGN 64					// Every array starts on its own cache line, vector loads stay aligned
+#define SLOT_MASK (ECS_MAX_ENTITIES - 1)
+#define GENERATION_MASK ((1u << (32 - ECS_SLOT_BITS)) - 1)
+
+// Command header in the buffer, SET is followed by the value
+typedef struct {
+	ecs_command_type_t type;
+	ecs_entity_t entity;
+	ecs_mask_t mask;					// CREATE
+	int component;						// ADD, REMOVE and SET
+	size_t size;						// Bytes of the value, padded in the buffer
+} command_t;
+
+static size_t align_up(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static bool grow(void **array, int *capacity, int count, size_t item_size) {
+	if (count < *capacity)
+		return true;
+	int new_capacity = *capacity ? *capacity * 2 : 16;
+	void *items = realloc(*array, item_size * new_capacity);
+	if (!items) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to grow the ECS.\n");
+		return false;
+	}
+	*array = items;
+	*capacity = new_capacity;
+	return true;
+}
+
+// Grows an array to exactly count items when it holds fewer
+static bool reserve(void **array, int *capacity, int count, size_t item_size) {
+	if (count <= *capacity)
+		return true;
+	void *items = realloc(*array, item_size * count);
+	if (!items) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to grow the ECS.\n");
+		return false;
+	}
+	*array = items;
+	*capacity = count;
+	return true;
+}
+
+// --- Archetypes and chunks ---
+
+// Places the arrays of an archetype in a chunk, returns the bytes used
+static size_t layout(const ecs_world_t *world, ecs_archetype_t *archetype, int capacity) {
+	size_t offset = align_up(sizeof(ecs_chunk_t), CHUNK_ALIGN);
+	archetype->entity_offset = offset;
+	offset = align_up(offset + sizeof(ecs_entity_t) * capacity, CHUNK_ALIGN);
+	for (int c = 0; c < world->component_count; ++c) {
+		if (archetype->mask & ECS_COMPONENT(c)) {
+			archetype->offsets[c] = offset;
+			offset = align_up(offset + world->sizes[c] * capacity, CHUNK_ALIGN);
+		}
+	}
+	return offset;
+}
+
+static int find_archetype(ecs_world_t *world, ecs_mask_t mask) {
+	for (int i = 0; i < world->archetype_count; ++i)
+		if (world->archetypes[i].mask == mask)
+			return i;
+
+	if (world->archetype_count == ECS_MAX_ARCHETYPES) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Too many component sets, at most %d.\n", ECS_MAX_ARCHETYPES);
+		return -1;
+	}
+
+	// As many entities as fit once every array is aligned
+	ecs_archetype_t archetype = {.mask = mask};
+	size_t row_size = sizeof(ecs_entity_t);
+	for (int c = 0; c < world->component_count; ++c)
+		if (mask & ECS_COMPONENT(c))
+			row_size += world->sizes[c];
+	int capacity = (int)((ECS_CHUNK_SIZE - align_up(sizeof(ecs_chunk_t), CHUNK_ALIGN)) / row_size);
+	while (capacity > 0 && layout(world, &archetype, capacity) > ECS_CHUNK_SIZE)
+		capacity--;
+	if (capacity == 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Components of mask 0x%x do not fit in a chunk.\n", (unsigned)mask);
+		return -1;
+	}
+	archetype.capacity = capacity;
+
+	world->archetypes[world->archetype_count] = archetype;
+	return world->archetype_count++;
+}
+
+static void *column(const ecs_archetype_t *archetype, ecs_chunk_t *chunk, int component) {
+	return (uint8_t *)chunk + archetype->offsets[component];
+}
+
+static ecs_entity_t *entities(const ecs_archetype_t *archetype, ecs_chunk_t *chunk) {
+	return (ecs_entity_t *)((uint8_t *)chunk + archetype->entity_offset);
+}
+
+// Reserves the next row of an archetype, a chunk is only added when the last one is full
+static bool push_row(ecs_world_t *world, int index, int *chunk, int *row) {
+	ecs_archetype_t *archetype = &world->archetypes[index];
+	if (archetype->chunk_count == 0 || archetype->chunks[archetype->chunk_count - 1]->count == archetype->capacity) {
+		if (!grow((void **)&archetype->chunks, &archetype->chunk_capacity, archetype->chunk_count, sizeof(ecs_chunk_t *)))
+			return false;
+		ecs_chunk_t *block = archetype->free_chunks;
+		if (block) {
+			archetype->free_chunks = block->next_free;
+			archetype->free_count--;
+		} else {
+			block = SDL_SIMDAlloc(ECS_CHUNK_SIZE);
+		}
+		if (!block) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for an ECS chunk.\n");
+			return false;
+		}
+		*block = (ecs_chunk_t){.count = 0, .archetype = index};
+		archetype->chunks[archetype->chunk_count++] = block;
+	}
+
+	*chunk = archetype->chunk_count - 1;
+	*row = archetype->chunks[*chunk]->count++;
+	return true;
+}
+
+// Fills a row with the last entity of the archetype, so only the last chunk is ever partly filled
+static void pop_row(ecs_world_t *world, int index, int chunk, int row) {
+	ecs_archetype_t *archetype = &world->archetypes[index];
+	ecs_chunk_t *last = archetype->chunks[archetype->chunk_count - 1];
+	int last_row = --last->count;
+
+	ecs_chunk_t *target = archetype->chunks[chunk];
+	if (target != last || row != last_row) {
+		for (int c = 0; c < world->component_count; ++c) {
+			if (archetype->mask & ECS_COMPONENT(c)) {
+				size_t size = world->sizes[c];
+				memcpy((uint8_t *)column(archetype, target, c) + size * row, (uint8_t *)column(archetype, last, c) + size * last_row, size);
+			}
+		}
+		ecs_entity_t moved = entities(archetype, last)[last_row];
+		entities(archetype, target)[row] = moved;
+		ecs_slot_t *slot = &world->slots[moved & SLOT_MASK];
+		slot->chunk = chunk;
+		slot->row = row;
+	}
+
+	// Kept for the next entities, bursts of creations after removals do not allocate
+	if (last->count == 0) {
+		last->next_free = archetype->free_chunks;
+		archetype->free_chunks = last;
+		archetype->free_count++;
+		archetype->chunk_count--;
+	}
+}
+
+static ecs_slot_t *lookup(const ecs_world_t *world, ecs_entity_t entity) {
+	int slot = (int)(entity & SLOT_MASK);
+	if (entity == ECS_ENTITY_NONE || slot >= world->slot_count || world->slots[slot].generation != entity >> ECS_SLOT_BITS)
+		return NULL;
+	return &world->slots[slot];
+}
+
+// Moves an entity to the archetype of a new mask, shared components keep their values
+static bool change_mask(ecs_world_t *world, ecs_entity_t entity, ecs_mask_t mask) {
+	ecs_slot_t *slot = lookup(world, entity);
+	if (!slot)
+		return false;
+	ecs_archetype_t *from = &world->archetypes[slot->archetype];
+	if (from->mask == mask)
+		return true;
+
+	int index = find_archetype(world, mask);
+	int chunk, row;
+	if (index < 0 || !push_row(world, index, &chunk, &row))
+		return false;
+
+	from = &world->archetypes[slot->archetype];
+	ecs_archetype_t *to = &world->archetypes[index];
+	ecs_chunk_t *source = from->chunks[slot->chunk];
+	ecs_chunk_t *target = to->chunks[chunk];
+	for (int c = 0; c < world->component_count; ++c) {
+		if (!(mask & ECS_COMPONENT(c)))
+			continue;
+		size_t size = world->sizes[c];
+		uint8_t *value = (uint8_t *)column(to, target, c) + size * row;
+		if (from->mask & ECS_COMPONENT(c))
+			memcpy(value, (uint8_t *)column(from, source, c) + size * slot->row, size);
+		else
+			memset(value, 0, size);
+	}
+	entities(to, target)[row] = entity;
+
+	pop_row(world, slot->archetype, slot->chunk, slot->row);
+	*slot = (ecs_slot_t){.archetype = index, .chunk = chunk, .row = row, .generation = slot->generation, .next_free = -1};
+	return true;
+}
+
+// --- World ---
+
+bool ecs_init(ecs_world_t *world, const size_t *sizes, int count) {
+	*world = (ecs_world_t){.free_slot = -1};
+	if (count > ECS_MAX_COMPONENTS) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Too many components, at most %d.\n", ECS_MAX_COMPONENTS);
+		return false;
+	}
+	memcpy(world->sizes, sizes, sizeof(size_t) * count);
+	world->component_count = count;
+	return true;
+}
+
+void ecs_destroy(ecs_world_t *world) {
+	for (int i = 0; i < world->archetype_count; ++i) {
+		ecs_archetype_t *archetype = &world->archetypes[i];
+		for (int c = 0; c < archetype->chunk_count; ++c)
+			SDL_SIMDFree(archetype->chunks[c]);
+		while (archetype->free_chunks) {
+			ecs_chunk_t *next = archetype->free_chunks->next_free;
+			SDL_SIMDFree(archetype->free_chunks);
+			archetype->free_chunks = next;
+		}
+		free(archetype->chunks);
+	}
+	free(world->slots);
+	*world = (ecs_world_t){.free_slot = -1};
+}
+
+bool ecs_reserve(ecs_world_t *world, ecs_mask_t mask, int count) {
+	if (count > ECS_MAX_ENTITIES - world->entity_count) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Too many entities, at most %d.\n", ECS_MAX_ENTITIES);
+		return false;
+	}
+	// Free slots are not counted, some may be left over
+	int slots = SDL_min(world->slot_count + count, ECS_MAX_ENTITIES);
+	if (!reserve((void **)&world->slots, &world->slot_capacity, slots, sizeof(ecs_slot_t)))
+		return false;
+
+	int index = find_archetype(world, mask);
+	if (index < 0)
+		return false;
+	ecs_archetype_t *archetype = &world->archetypes[index];
+	int room = archetype->free_count * archetype->capacity;
+	if (archetype->chunk_count > 0)
+		room += archetype->capacity - archetype->chunks[archetype->chunk_count - 1]->count;
+	for (; room < count; room += archetype->capacity) {
+		ecs_chunk_t *block = SDL_SIMDAlloc(ECS_CHUNK_SIZE);
+		if (!block) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for an ECS chunk.\n");
+			return false;
+		}
+		block->next_free = archetype->free_chunks;
+		archetype->free_chunks = block;
+		archetype->free_count++;
+	}
+	return reserve((void **)&archetype->chunks, &archetype->chunk_capacity, archetype->chunk_count + archetype->free_count, sizeof(ecs_chunk_t *));
+}
+
+ecs_entity_t ecs_create(ecs_world_t *world, ecs_mask_t mask) {
+	int index = find_archetype(world, mask);
+	if (index < 0)
+		return ECS_ENTITY_NONE;
+
+	// Reuse a slot when one is free, its generation was bumped when it was freed
+	int slot = world->free_slot;
+	if (slot < 0) {
+		if (world->slot_count == ECS_MAX_ENTITIES) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Too many entities, at most %d.\n", ECS_MAX_ENTITIES);
+			return ECS_ENTITY_NONE;
+		}
+		if (!grow((void **)&world->slots, &world->slot_capacity, world->slot_count, sizeof(ecs_slot_t)))
+			return ECS_ENTITY_NONE;
+		slot = world->slot_count;
+		world->slots[slot].generation = 1;
+	}
+
+	int chunk, row;
+	if (!push_row(world, index, &chunk, &row))
+		return ECS_ENTITY_NONE;
+	if (slot == world->slot_count)
+		world->slot_count++;
+	else
+		world->free_slot = world->slots[slot].next_free;
+
+	ecs_slot_t *entry = &world->slots[slot];
+	*entry = (ecs_slot_t){.archetype = index, .chunk = chunk, .row = row, .generation = entry->generation, .next_free = -1};
+	ecs_entity_t entity = (ecs_entity_t)entry->generation << ECS_SLOT_BITS | (ecs_entity_t)slot;
+
+	// Components start zeroed
+	ecs_archetype_t *archetype = &world->archetypes[index];
+	ecs_chunk_t *block = archetype->chunks[chunk];
+	for (int c = 0; c < world->component_count; ++c)
+		if (mask & ECS_COMPONENT(c))
+			memset((uint8_t *)column(archetype, block, c) + world->sizes[c] * row, 0, world->sizes[c]);
+	entities(archetype, block)[row] = entity;
+	world->entity_count++;
+	return entity;
+}
+
+bool ecs_remove(ecs_world_t *world, ecs_entity_t entity) {
+	ecs_slot_t *slot = lookup(world, entity);
+	if (!slot)
+		return false;
+
+	pop_row(world, slot->archetype, slot->chunk, slot->row);
+
+	// New generation right away, so the handle is stale even before the slot is reused
+	uint16_t generation = (slot->generation + 1) & GENERATION_MASK;
+	slot->generation = generation ? generation : 1;
+	slot->next_free = world->free_slot;
+	world->free_slot = (int)(entity & SLOT_MASK);
+	world->entity_count--;
+	return true;
+}
+
+bool ecs_add_component(ecs_world_t *world, ecs_entity_t entity, int component) {
+	const ecs_slot_t *slot = lookup(world, entity);
+	return slot && change_mask(world, entity, world->archetypes[slot->archetype].mask | ECS_COMPONENT(component));
+}
+
+bool ecs_remove_component(ecs_world_t *world, ecs_entity_t entity, int component) {
+	const ecs_slot_t *slot = lookup(world, entity);
+	return slot && change_mask(world, entity, world->archetypes[slot->archetype].mask & ~ECS_COMPONENT(component));
+}
+
+bool ecs_alive(const ecs_world_t *world, ecs_entity_t entity) {
+	return lookup(world, entity) != NULL;
+}
+
+void *ecs_get(ecs_world_t *world, ecs_entity_t entity, int component) {
+	const ecs_slot_t *slot = lookup(world, entity);
+	if (!slot)
+		return NULL;
+	ecs_archetype_t *archetype = &world->archetypes[slot->archetype];
+	if (!(archetype->mask & ECS_COMPONENT(component)))
+		return NULL;
+	return (uint8_t *)column(archetype, archetype->chunks[slot->chunk], component) + world->sizes[component] * slot->row;
+}
+
+// --- Queries ---
+
+ecs_query_t ecs_query(ecs_world_t *world, ecs_mask_t mask) {
+	return (ecs_query_t){.world = world, .mask = mask, .archetype = 0, .chunk = -1};
+}
+
+bool ecs_query_next(ecs_query_t *query) {
+	// Chunks are never empty, the last one goes to the free list with its last entity
+	query->chunk++;
+	for (; query->archetype < query->world->archetype_count; query->archetype++, query->chunk = 0) {
+		const ecs_archetype_t *archetype = &query->world->archetypes[query->archetype];
+		if ((archetype->mask & query->mask) == query->mask && query->chunk < archetype->chunk_count) {
+			query->current = archetype->chunks[query->chunk];
+			return true;
+		}
+	}
+	query->current = NULL;
+	return false;
+}
+
+int ecs_query_count(const ecs_query_t *query) {
+	return query->current->count;
+}
+
+void *ecs_query_column(const ecs_query_t *query, int component) {
+	return column(&query->world->archetypes[query->archetype], query->current, component);
+}
+
+const ecs_entity_t *ecs_query_entities(const ecs_query_t *query) {
+	return entities(&query->world->archetypes[query->archetype], query->current);
+}
+
+int ecs_query_chunks(ecs_world_t *world, ecs_mask_t mask, ecs_query_t *chunks, int capacity) {
+	int count = 0;
+	for (ecs_query_t query = ecs_query(world, mask); ecs_query_next(&query); ++count)
+		if (count < capacity)
+			chunks[count] = query;
+	return count;
+}
+
+// --- Command buffer ---
+
+static bool push_command(ecs_commands_t *commands, command_t command, const void *value) {
+	size_t bytes = align_up(sizeof(command_t) + command.size, sizeof(max_align_t));
+	if (commands->size + bytes > commands->capacity) {
+		size_t capacity = commands->capacity ? commands->capacity * 2 : 4096;
+		while (capacity < commands->size + bytes)
+			capacity *= 2;
+		uint8_t *data = realloc(commands->data, capacity);
+		if (!data) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to record an ECS command.\n");
+			return false;
+		}
+		commands->data = data;
+		commands->capacity = capacity;
+	}
+
+	memcpy(commands->data + commands->size, &command, sizeof(command_t));
+	if (command.size)
+		memcpy(commands->data + commands->size + sizeof(command_t), value, command.size);
+	commands->size += bytes;
+	return true;
+}
+
+void ecs_commands_init(ecs_commands_t *commands) {
+	*commands = (ecs_commands_t){0};
+}
+
+void ecs_commands_destroy(ecs_commands_t *commands) {
+	free(commands->data);
+	*commands = (ecs_commands_t){0};
+}
+
+bool ecs_defer_create(ecs_commands_t *commands, ecs_mask_t mask) {
+	return push_command(commands, (command_t){.type = ECS_COMMAND_CREATE, .mask = mask}, NULL);
+}
+
+bool ecs_defer_destroy(ecs_commands_t *commands, ecs_entity_t entity) {
+	return push_command(commands, (command_t){.type = ECS_COMMAND_DESTROY, .entity = entity}, NULL);
+}
+
+bool ecs_defer_add(ecs_commands_t *commands, ecs_entity_t entity, int component) {
+	return push_command(commands, (command_t){.type = ECS_COMMAND_ADD, .entity = entity, .component = component}, NULL);
+}
+
+bool ecs_defer_remove(ecs_commands_t *commands, ecs_entity_t entity, int component) {
+	return push_command(commands, (command_t){.type = ECS_COMMAND_REMOVE, .entity = entity, .component = component}, NULL);
+}
+
+bool ecs_defer_set(ecs_commands_t *commands, ecs_entity_t entity, int component, const void *value, size_t size) {
+	return push_command(commands, (command_t){.type = ECS_COMMAND_SET, .entity = entity, .component = component, .size = size}, value);
+}
+
+void ecs_flush(ecs_world_t *world, ecs_commands_t *commands) {
+	ecs_entity_t created = ECS_ENTITY_NONE;
+
+	for (size_t offset = 0; offset < commands->size;) {
+		command_t command;
+		memcpy(&command, commands->data + offset, sizeof(command_t));
+		const uint8_t *value = commands->data + offset + sizeof(command_t);
+		offset += align_up(sizeof(command_t) + command.size, sizeof(max_align_t));
+
+		// Commands on entities destroyed earlier in the buffer are dropped by the handle check
+		switch (command.type) {
+		case ECS_COMMAND_CREATE:
+			created = ecs_create(world, command.mask);
+			break;
+		case ECS_COMMAND_DESTROY:
+			ecs_remove(world, command.entity);
+			break;
+		case ECS_COMMAND_ADD:
+			ecs_add_component(world, command.entity, command.component);
+			break;
+		case ECS_COMMAND_REMOVE:
+			ecs_remove_component(world, command.entity, command.component);
+			break;
+		case ECS_COMMAND_SET: {
+			ecs_entity_t entity = command.entity == ECS_ENTITY_NONE ? created : command.entity;
+			void *component = ecs_get(world, entity, command.component);
+			if (component)
+				memcpy(component, value, SDL_min(command.size, world->sizes[command.component]));
+			break;
+		}
+		}
+	}
+	commands->size = 0;
+}
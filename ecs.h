@@ -0,0 +1,125 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ECS_CHUNK_SIZE (16 * 1024)
+#define ECS_MAX_COMPONENTS 32
+#define ECS_MAX_ARCHETYPES 64
+#define ECS_ENTITY_NONE 0				// Generation 0 is never used, so no valid entity is 0
+#define ECS_SLOT_BITS 20
+#define ECS_MAX_ENTITIES (1 << ECS_SLOT_BITS)
+
+// Entity handle: slot in the low bits, generation of the slot in the high bits.
+// A slot gets a new generation when its entity is destroyed, so old handles stay invalid.
+typedef uint32_t ecs_entity_t;
+// Set of components, bit i is component i
+typedef uint32_t ecs_mask_t;
+
+#define ECS_COMPONENT(id) ((ecs_mask_t)1 << (id))
+
+// Header of a block of ECS_CHUNK_SIZE bytes holding entities of one archetype,
+// each component is one contiguous array at the offset given by the archetype
+typedef struct ecs_chunk {
+	int count;
+	int archetype;
+	struct ecs_chunk *next_free;		// Next chunk of the free list while the chunk is unused
+} ecs_chunk_t;
+
+// Every entity with exactly the same components
+typedef struct {
+	ecs_mask_t mask;
+	int capacity;						// Entities per chunk
+	size_t offsets[ECS_MAX_COMPONENTS];	// Start of each component array from the chunk header
+	size_t entity_offset;				// Start of the entity handle array
+	ecs_chunk_t **chunks;				// Only the last chunk may be partly filled
+	int chunk_count, chunk_capacity;
+	ecs_chunk_t *free_chunks;			// Emptied or reserved chunks, used before allocating another one
+	int free_count;
+} ecs_archetype_t;
+
+// Where the entity of a slot is stored
+typedef struct {
+	int archetype;
+	int chunk;
+	int row;
+	uint16_t generation;
+	int next_free;						// Next free slot while the slot is unused
+} ecs_slot_t;
+
+typedef struct {
+	size_t sizes[ECS_MAX_COMPONENTS];
+	int component_count;
+	ecs_archetype_t archetypes[ECS_MAX_ARCHETYPES];
+	int archetype_count;
+	ecs_slot_t *slots;
+	int slot_count, slot_capacity;
+	int free_slot;						// Head of the free slot list, -1 when empty
+	int entity_count;
+} ecs_world_t;
+
+// Chunks of every archetype holding all the components of a mask
+typedef struct {
+	ecs_world_t *world;
+	ecs_mask_t mask;
+	int archetype;
+	int chunk;
+	ecs_chunk_t *current;				// Set by ecs_query_next
+} ecs_query_t;
+
+typedef enum {
+	ECS_COMMAND_CREATE,
+	ECS_COMMAND_DESTROY,
+	ECS_COMMAND_ADD,
+	ECS_COMMAND_REMOVE,
+	ECS_COMMAND_SET,
+} ecs_command_type_t;
+
+// Structural changes recorded while chunks are iterated, applied by ecs_flush
+typedef struct {
+	uint8_t *data;						// Commands followed by their component values
+	size_t size, capacity;
+} ecs_commands_t;
+
+// Components are given by their sizes, ids are the indexes in the array
+bool ecs_init(ecs_world_t *world, const size_t *sizes, int count);
+void ecs_destroy(ecs_world_t *world);
+// Makes room for count more entities of a mask (slots, chunks and chunk table) so that creating them
+// allocates nothing. Chunks are kept by their archetype once emptied, later bursts reuse them too.
+bool ecs_reserve(ecs_world_t *world, ecs_mask_t mask, int count);
+
+// Immediate changes, they move entities between chunks so not while iterating
+ecs_entity_t ecs_create(ecs_world_t *world, ecs_mask_t mask);
+bool ecs_remove(ecs_world_t *world, ecs_entity_t entity);
+bool ecs_add_component(ecs_world_t *world, ecs_entity_t entity, int component);
+bool ecs_remove_component(ecs_world_t *world, ecs_entity_t entity, int component);
+
+bool ecs_alive(const ecs_world_t *world, ecs_entity_t entity);
+// Component of an entity, NULL when the entity is stale or does not have it
+void *ecs_get(ecs_world_t *world, ecs_entity_t entity, int component);
+
+// Iterates chunks, a mask of 0 matches every entity
+ecs_query_t ecs_query(ecs_world_t *world, ecs_mask_t mask);
+bool ecs_query_next(ecs_query_t *query);
+int ecs_query_count(const ecs_query_t *query);
+// Array of a component in the current chunk, the component must be part of the query
+void *ecs_query_column(const ecs_query_t *query, int component);
+const ecs_entity_t *ecs_query_entities(const ecs_query_t *query);
+// Every matching chunk as its own query on that chunk, so chunks can be handed to other threads.
+// Writes at most capacity of them, returns how many there are.
+int ecs_query_chunks(ecs_world_t *world, ecs_mask_t mask, ecs_query_t *chunks, int capacity);
+
+// Deferred changes; SET on ECS_ENTITY_NONE sets a component of the entity of the last CREATE
+void ecs_commands_init(ecs_commands_t *commands);
+void ecs_commands_destroy(ecs_commands_t *commands);
+bool ecs_defer_create(ecs_commands_t *commands, ecs_mask_t mask);
+bool ecs_defer_destroy(ecs_commands_t *commands, ecs_entity_t entity);
+bool ecs_defer_add(ecs_commands_t *commands, ecs_entity_t entity, int component);
+bool ecs_defer_remove(ecs_commands_t *commands, ecs_entity_t entity, int component);
+bool ecs_defer_set(ecs_commands_t *commands, ecs_entity_t entity, int component, const void *value, size_t size);
+// Applies every command in order and empties the buffer
+void ecs_flush(ecs_world_t *world, ecs_commands_t *commands);
+
+#endif // ECS_H
@@ -0,0 +1,140 @@
+#include "hot_reload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#define SETTLE_MS 50					// Editors write a file in several steps, wait until it is quiet
+#define MAX_BATCH 32
+
+#ifdef __linux__
+static bool is_image(const char *name) {
+	const char *ext = strrchr(name, '.');
+	return ext && strcmp(ext, ".png") == 0;
+}
+
+static void publish(hot_reload_t *watcher, const char *name) {
+	char *path = malloc(strlen(watcher->dir) + strlen(name) + 2);
+	if (!path) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to reload %s.\n", name);
+		return;
+	}
+	sprintf(path, "%s/%s", watcher->dir, name);
+	if (!mpmc_queue_push(&watcher->changed, path)) {
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Too many changed files, %s is not reloaded\n", path);
+		free(path);
+	}
+}
+
+static int watcher_main(void *data) {
+	hot_reload_t *watcher = data;
+	_Alignas(struct inotify_event) char buffer[4096];
+	char batch[MAX_BATCH][HOT_RELOAD_PATH_SIZE];
+	int batch_count = 0;
+	const size_t dir_length = strlen(watcher->dir);
+
+	while (!atomic_load(&watcher->quit)) {
+		// Short timeout so quit is noticed, and changes are sent once the directory settles
+		struct pollfd fds = {.fd = watcher->fd, .events = POLLIN};
+		int ready = poll(&fds, 1, batch_count ? SETTLE_MS : 100);
+		if (ready < 0) {
+			// A signal cut the wait short, the batch may not have settled yet
+			if (errno == EINTR)
+				continue;
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not wait for file changes: %s\n", strerror(errno));
+			return 1;
+		}
+		if (ready <= 0) {
+			for (int i = 0; i < batch_count; ++i)
+				publish(watcher, batch[i]);
+			batch_count = 0;
+			continue;
+		}
+
+		ssize_t length = read(watcher->fd, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length;) {
+			const struct inotify_event *event = (const struct inotify_event *)(buffer + offset);
+			offset += sizeof(struct inotify_event) + event->len;
+			if (!event->len || !is_image(event->name))
+				continue;
+			// Published as dir/name, which must fit the path buffers of hot_reload_poll callers
+			if (dir_length + 1 + strlen(event->name) >= HOT_RELOAD_PATH_SIZE) {
+				SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Path of %s/%s is too long, it is not reloaded\n", watcher->dir, event->name);
+				continue;
+			}
+
+			// Several writes of the same file are reloaded once
+			bool seen = false;
+			for (int i = 0; i < batch_count && !seen; ++i)
+				seen = strcmp(batch[i], event->name) == 0;
+			if (!seen && batch_count < MAX_BATCH)
+				strcpy(batch[batch_count++], event->name);
+		}
+	}
+	return 0;
+}
+#endif
+
+bool hot_reload_init(hot_reload_t *watcher, const char *dir) {
+	*watcher = (hot_reload_t){.fd = -1};
+	atomic_init(&watcher->quit, false);
+	snprintf(watcher->dir, sizeof(watcher->dir), "%s", dir);
+
+#ifdef __linux__
+	if (!mpmc_queue_init(&watcher->changed, HOT_RELOAD_QUEUE_SIZE))
+		return false;
+
+	watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watcher->fd < 0 || inotify_add_watch(watcher->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Could not watch %s, hot reload is off: %s\n", dir, strerror(errno));
+		if (watcher->fd >= 0)
+			close(watcher->fd);
+		watcher->fd = -1;
+		return true;
+	}
+
+	watcher->thread = SDL_CreateThread(watcher_main, "hot_reload", watcher);
+	if (!watcher->thread) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create watcher thread: %s\n", SDL_GetError());
+		return false;
+	}
+	SDL_Log("Watching %s for changes\n", dir);
+#else
+	SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Hot reload is only supported on Linux\n");
+#endif
+	return true;
+}
+
+void hot_reload_destroy(hot_reload_t *watcher) {
+	atomic_store(&watcher->quit, true);
+	if (watcher->thread)
+		SDL_WaitThread(watcher->thread, NULL);
+
+#ifdef __linux__
+	if (watcher->fd >= 0)
+		close(watcher->fd);
+#endif
+
+	void *item;
+	if (watcher->changed.cells)
+		while (mpmc_queue_pop(&watcher->changed, &item))
+			free(item);
+	mpmc_queue_destroy(&watcher->changed);
+	*watcher = (hot_reload_t){.fd = -1};
+}
+
+bool hot_reload_poll(hot_reload_t *watcher, char *path, size_t size) {
+	void *item;
+	if (!watcher->changed.cells || !mpmc_queue_pop(&watcher->changed, &item))
+		return false;
+	snprintf(path, size, "%s", (char *)item);
+	free(item);
+	return true;
+}
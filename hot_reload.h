@@ -0,0 +1,31 @@
+#ifndef HOT_RELOAD_H
+#define HOT_RELOAD_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <SDL.h>
+
+#include "mpmc_queue.h"
+
+#define HOT_RELOAD_QUEUE_SIZE 64
+#define HOT_RELOAD_PATH_SIZE 256
+
+// Watches a directory for images written on disk, only supported on Linux (inotify)
+typedef struct {
+	SDL_Thread *thread;
+	int fd;								// inotify instance, -1 when not watching
+	atomic_bool quit;
+	mpmc_queue_t changed;				// Paths of changed files, filled by the watcher thread
+	char dir[HOT_RELOAD_PATH_SIZE];
+} hot_reload_t;
+
+// Watching is optional: a platform without inotify only logs a warning
+bool hot_reload_init(hot_reload_t *watcher, const char *dir);
+void hot_reload_destroy(hot_reload_t *watcher);
+
+// Next changed file since the last call, false when there is none
+bool hot_reload_poll(hot_reload_t *watcher, char *path, size_t size);
+
+#endif // HOT_RELOAD_H
@@ -0,0 +1,110 @@
+#include "integrate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#define BENCH_PASSES 64
+
+void integrate_scalar(float *position, float *velocity, const float *extent, const float *bounce, int count,
+					  float dt, const float limit[2]) {
+	for (int i = 0; i < count * 2; ++i) {
+		float moved = position[i] + velocity[i] * dt;
+		float clamped = SDL_min(SDL_max(moved, 0.0f), limit[i & 1] - extent[i]);
+		if (clamped != moved)
+			velocity[i] *= bounce[i];
+		position[i] = clamped;
+	}
+}
+
+// x and y alternate in the arrays, so the limit vector alternates width and height.
+// A lane that was clamped takes its velocity times bounce, picked by the mask without a branch.
+
+#ifdef SIMD_SSE2
+static void integrate_sse2(float *position, float *velocity, const float *extent, const float *bounce, int count,
+						   float dt, const float limit[2]) {
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 bound = _mm_setr_ps(limit[0], limit[1], limit[0], limit[1]);
+	int n = count * 2, i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 v = _mm_loadu_ps(velocity + i);
+		__m128 moved = _mm_add_ps(_mm_loadu_ps(position + i), _mm_mul_ps(v, step));
+		__m128 clamped = _mm_min_ps(_mm_max_ps(moved, zero), _mm_sub_ps(bound, _mm_loadu_ps(extent + i)));
+		__m128 hit = _mm_cmpneq_ps(clamped, moved);
+		__m128 bounced = _mm_mul_ps(v, _mm_loadu_ps(bounce + i));
+		_mm_storeu_ps(velocity + i, _mm_or_ps(_mm_and_ps(hit, bounced), _mm_andnot_ps(hit, v)));
+		_mm_storeu_ps(position + i, clamped);
+	}
+	// Odd pair left over, the scalar loop restarts on an x
+	integrate_scalar(position + i, velocity + i, extent + i, bounce + i, (n - i) / 2, dt, limit);
+}
+#endif
+
+#ifdef SIMD_AVX2
+SIMD_TARGET_AVX2
+static void integrate_avx2(float *position, float *velocity, const float *extent, const float *bounce, int count,
+						   float dt, const float limit[2]) {
+	const __m256 step = _mm256_set1_ps(dt);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 bound = _mm256_setr_ps(limit[0], limit[1], limit[0], limit[1], limit[0], limit[1], limit[0], limit[1]);
+	int n = count * 2, i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 v = _mm256_loadu_ps(velocity + i);
+		__m256 moved = _mm256_add_ps(_mm256_loadu_ps(position + i), _mm256_mul_ps(v, step));
+		__m256 clamped = _mm256_min_ps(_mm256_max_ps(moved, zero), _mm256_sub_ps(bound, _mm256_loadu_ps(extent + i)));
+		__m256 hit = _mm256_cmp_ps(clamped, moved, _CMP_NEQ_UQ);
+		_mm256_storeu_ps(velocity + i, _mm256_blendv_ps(v, _mm256_mul_ps(v, _mm256_loadu_ps(bounce + i)), hit));
+		_mm256_storeu_ps(position + i, clamped);
+	}
+	integrate_scalar(position + i, velocity + i, extent + i, bounce + i, (n - i) / 2, dt, limit);
+}
+#endif
+
+SIMD_DEFINE(integrate, integrate_fn, integrate_scalar, integrate_sse2, integrate_avx2)
+
+// Actors per nanosecond of one kernel, the arrays are left as the last pass wrote them
+static double measure(integrate_fn kernel, float *position, float *velocity, const float *extent, const float *bounce,
+					  int count, const float limit[2]) {
+	uint64_t start = SDL_GetPerformanceCounter();
+	for (int pass = 0; pass < BENCH_PASSES; ++pass)
+		kernel(position, velocity, extent, bounce, count, 1.0f / 165.0f, limit);
+	double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+	return seconds > 0 ? (double)count * BENCH_PASSES / (seconds * 1e9) : 0;
+}
+
+bool integrate_bench(int count) {
+	size_t bytes = sizeof(float) * 2 * (size_t)count;
+	float *data = malloc(bytes * 6);
+	if (!data) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to benchmark %d actors.\n", count);
+		return false;
+	}
+	float *extent = data, *position = data + 2 * count, *velocity = data + 4 * count;
+	float *expected_position = data + 6 * count, *expected_velocity = data + 8 * count, *bounce = data + 10 * count;
+	const float limit[2] = {2560, 1440};
+
+	// Same starting state for both kernels, some actors start outside so every edge is hit.
+	// Actors either turn back or stop there.
+	for (int i = 0; i < count * 2; ++i) {
+		extent[i] = (float)(32 * (1 + rand() % 4));
+		bounce[i] = rand() % 2 ? -1.0f : 0.0f;
+		position[i] = (float)(rand() % 2700) - 70.0f;
+		velocity[i] = (float)(rand() % 801) - 400.0f;
+	}
+	memcpy(expected_position, position, bytes);
+	memcpy(expected_velocity, velocity, bytes);
+
+	integrate_fn kernel = integrate_select();
+	double reference = measure(integrate_scalar, expected_position, expected_velocity, extent, bounce, count, limit);
+	double selected = measure(kernel, position, velocity, extent, bounce, count, limit);
+	bool same = memcmp(position, expected_position, bytes) == 0 && memcmp(velocity, expected_velocity, bytes) == 0;
+	free(data);
+
+	SDL_Log("Integration of %d actors: scalar %.3f actors/ns, %s %.3f actors/ns\n",
+			count, reference, integrate_name(kernel), selected);
+	if (!same)
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s integration does not match the scalar one.\n", integrate_name(kernel));
+	return same;
+}
@@ -0,0 +1,23 @@
+#ifndef INTEGRATE_H
+#define INTEGRATE_H
+
+#include <stdbool.h>
+
+#include "simd.h"
+
+// Moves count actors by velocity * dt and keeps them inside [0, limit - extent], multiplying the
+// velocity by bounce on each axis that hit an edge. Arrays are {x, y} pairs, limit is {width, height}.
+typedef void (*integrate_fn)(float *position, float *velocity, const float *extent, const float *bounce, int count,
+							 float dt, const float limit[2]);
+
+// Reference implementation, every other variant gives the same result
+void integrate_scalar(float *position, float *velocity, const float *extent, const float *bounce, int count,
+					  float dt, const float limit[2]);
+
+SIMD_DECLARE(integrate, integrate_fn);
+
+// Runs the scalar and selected kernels over count actors, logs actors per nanosecond of both.
+// False when they disagree.
+bool integrate_bench(int count);
+
+#endif // INTEGRATE_H
@@ -0,0 +1,242 @@
+#include "job.h"
+
+#include <stdlib.h>
+
+#define DEQUE_MASK (JOB_DEQUE_SIZE - 1)
+
+// Worker of the calling thread, -1 outside the pool
+static _Thread_local int current_worker = -1;
+
+// --- Chase-Lev deque ---
+
+static bool deque_push(job_deque_t *deque, job_t *job) {
+	ptrdiff_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	ptrdiff_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	if (bottom - top >= JOB_DEQUE_SIZE)
+		return false;
+	atomic_store_explicit(&deque->jobs[bottom & DEQUE_MASK], job, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+	return true;
+}
+
+// Owner only, newest job first so it is still in cache
+static job_t *deque_take(job_deque_t *deque) {
+	ptrdiff_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	ptrdiff_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+	job_t *job = NULL;
+	if (top <= bottom) {
+		job = atomic_load_explicit(&deque->jobs[bottom & DEQUE_MASK], memory_order_relaxed);
+		if (top != bottom)
+			return job;
+		// Last job, a thief may be taking it too
+		if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+			job = NULL;
+	}
+	atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+	return job;
+}
+
+// Any thread, oldest job first; NULL when empty or another thread won the race
+static job_t *deque_steal(job_deque_t *deque) {
+	ptrdiff_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	ptrdiff_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+	if (top >= bottom)
+		return NULL;
+
+	job_t *job = atomic_load_explicit(&deque->jobs[top & DEQUE_MASK], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+		return NULL;
+	return job;
+}
+
+// --- Jobs ---
+
+static void execute(job_system_t *system, job_t *job);
+
+// Queues on the deque of the calling thread, runs the job right away when that is not possible
+static void push(job_system_t *system, job_t *job) {
+	int worker = current_worker;
+	if (worker < 0 || !deque_push(&system->workers[worker].deque, job))
+		execute(system, job);
+}
+
+static void wake(job_system_t *system, int jobs) {
+	int sleepers = SDL_min(jobs, system->worker_count - 1);
+	for (int i = 0; i < sleepers; ++i)
+		SDL_SemPost(system->wake);
+}
+
+// Pushes the job unless it has to wait for after, true when pushed
+static bool queue(job_system_t *system, job_t *job, job_counter_t *after) {
+	if (job->done)
+		atomic_fetch_add(&job->done->pending, 1);
+
+	if (after) {
+		SDL_AtomicLock(&after->lock);
+		if (atomic_load(&after->pending) > 0) {
+			job->next = after->waiting;
+			after->waiting = job;
+			SDL_AtomicUnlock(&after->lock);
+			return false;
+		}
+		SDL_AtomicUnlock(&after->lock);
+	}
+	push(system, job);
+	return true;
+}
+
+// Counts one job of the counter done, the last one hands the jobs held on it to this thread
+static void count_done(job_system_t *system, job_counter_t *counter) {
+	if (atomic_fetch_sub(&counter->pending, 1) != 1)
+		return;
+
+	SDL_AtomicLock(&counter->lock);
+	job_t *waiting = counter->waiting;
+	counter->waiting = NULL;
+	SDL_AtomicUnlock(&counter->lock);
+
+	int released = 0;
+	for (job_t *next; waiting; waiting = next, ++released) {
+		next = waiting->next;
+		push(system, waiting);
+	}
+	wake(system, released);
+}
+
+static void execute(job_system_t *system, job_t *job) {
+	// Read before the counter moves, the job may be reused as soon as it reaches zero
+	job_counter_t *done = job->done;
+	job->fn(job->data, job->begin, job->end);
+	if (done)
+		count_done(system, done);
+}
+
+// Own jobs first, then the other deques starting after ours
+static job_t *find_job(job_system_t *system, int worker) {
+	job_t *job = deque_take(&system->workers[worker].deque);
+	for (int i = 1; !job && i < system->worker_count; ++i)
+		job = deque_steal(&system->workers[(worker + i) % system->worker_count].deque);
+	return job;
+}
+
+static int worker_main(void *data) {
+	job_worker_t *worker = data;
+	job_system_t *system = worker->system;
+	current_worker = worker->index;
+
+	while (!atomic_load(&system->quit)) {
+		job_t *job = find_job(system, worker->index);
+		if (job)
+			execute(system, job);
+		else
+			SDL_SemWait(system->wake);
+	}
+	return 0;
+}
+
+bool job_system_init(job_system_t *system, int threads) {
+	*system = (job_system_t){0};
+	atomic_init(&system->quit, false);
+	threads = SDL_clamp(threads, 0, JOB_MAX_WORKERS);
+
+	system->wake = SDL_CreateSemaphore(0);
+	if (!system->wake) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create job semaphore: %s\n", SDL_GetError());
+		return false;
+	}
+
+	// Every deque exists before a thread starts stealing
+	for (int i = 0; i <= threads; ++i) {
+		job_worker_t *worker = &system->workers[i];
+		*worker = (job_worker_t){.system = system, .index = i};
+		atomic_init(&worker->deque.top, 0);
+		atomic_init(&worker->deque.bottom, 0);
+		worker->deque.jobs = calloc(JOB_DEQUE_SIZE, sizeof(*worker->deque.jobs));
+		if (!worker->deque.jobs) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for a job deque.\n");
+			return false;
+		}
+		system->worker_count++;
+	}
+
+	current_worker = 0;
+	for (int i = 1; i < system->worker_count; ++i) {
+		system->workers[i].thread = SDL_CreateThread(worker_main, "job_worker", &system->workers[i]);
+		if (!system->workers[i].thread) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create job thread: %s\n", SDL_GetError());
+			return false;
+		}
+	}
+	SDL_Log("Job system started with %d threads\n", system->worker_count - 1);
+	return true;
+}
+
+void job_system_destroy(job_system_t *system) {
+	atomic_store(&system->quit, true);
+	for (int i = 1; i < system->worker_count; ++i)
+		SDL_SemPost(system->wake);
+	for (int i = 1; i < system->worker_count; ++i)
+		if (system->workers[i].thread)
+			SDL_WaitThread(system->workers[i].thread, NULL);
+	for (int i = 0; i < system->worker_count; ++i)
+		free((void *)system->workers[i].deque.jobs);
+	if (system->wake)
+		SDL_DestroySemaphore(system->wake);
+	if (current_worker == 0)
+		current_worker = -1;
+	*system = (job_system_t){0};
+}
+
+void job_counter_init(job_counter_t *counter) {
+	atomic_init(&counter->pending, 0);
+	counter->lock = 0;
+	counter->waiting = NULL;
+}
+
+bool job_counter_done(job_counter_t *counter) {
+	return atomic_load(&counter->pending) == 0;
+}
+
+void job_run(job_system_t *system, job_t *job, job_counter_t *after) {
+	if (queue(system, job, after))
+		wake(system, 1);
+}
+
+int job_parallel_for(job_system_t *system, job_t *jobs, int count, int batch, job_fn fn, void *data,
+					 job_counter_t *done, job_counter_t *after) {
+	if (batch < 1)
+		batch = 1;
+	int job_count = count > 0 ? (count + batch - 1) / batch : 1;
+
+	// Held up by one while the range is split, so jobs held on the counter cannot start before the last range is queued
+	if (done)
+		atomic_fetch_add(&done->pending, 1);
+
+	int pushed = 0;
+	for (int i = 0; i < job_count; ++i) {
+		int begin = i * batch;
+		jobs[i] = (job_t){.fn = fn, .data = data, .begin = begin, .end = SDL_min(count, begin + batch), .done = done};
+		pushed += queue(system, &jobs[i], after);
+	}
+	wake(system, pushed);
+
+	if (done)
+		count_done(system, done);
+	return job_count;
+}
+
+void job_wait(job_system_t *system, job_counter_t *counter) {
+	int worker = current_worker;
+	while (atomic_load(&counter->pending) > 0) {
+		job_t *job = worker >= 0 ? find_job(system, worker) : NULL;
+		if (job)
+			execute(system, job);
+		else
+			SDL_CPUPauseInstruction();
+	}
+}
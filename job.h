@@ -0,0 +1,77 @@
+#ifndef JOB_H
+#define JOB_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <SDL.h>
+
+#define JOB_MAX_WORKERS 32
+#define JOB_DEQUE_SIZE 4096				// Jobs queued per thread, a full deque runs the job right away
+
+// Runs indexes [begin, end) of a job
+typedef void (*job_fn)(void *data, int begin, int end);
+
+struct job;
+
+// Jobs left to finish, jobs queued after it start once it reaches zero
+typedef struct {
+	atomic_int pending;
+	SDL_SpinLock lock;					// Guards waiting
+	struct job *waiting;				// Jobs held until pending is zero
+} job_counter_t;
+
+// Owned by the caller, must stay in place until its counter is done
+typedef struct job {
+	job_fn fn;
+	void *data;
+	int begin, end;
+	job_counter_t *done;				// Decremented once the job ran, may be NULL
+	struct job *next;					// In the waiting list of a counter
+} job_t;
+
+// Chase-Lev deque: the owner pushes and takes at the bottom, other threads steal from the top
+typedef struct {
+	_Alignas(64) atomic_ptrdiff_t top;
+	_Alignas(64) atomic_ptrdiff_t bottom;
+	_Atomic(job_t *) *jobs;				// JOB_DEQUE_SIZE entries
+} job_deque_t;
+
+struct job_system;
+
+typedef struct {
+	struct job_system *system;
+	int index;
+	SDL_Thread *thread;					// NULL for the thread that created the system
+	job_deque_t deque;
+} job_worker_t;
+
+// Work-stealing pool: every thread runs its own jobs first, then steals from the others
+typedef struct job_system {
+	job_worker_t workers[JOB_MAX_WORKERS + 1];	// Worker 0 is the thread that called job_system_init
+	int worker_count;
+	SDL_sem *wake;						// Posted when jobs are queued, idle workers sleep on it
+	atomic_bool quit;
+} job_system_t;
+
+// Only the thread calling init and the pool threads may queue and wait on jobs
+bool job_system_init(job_system_t *system, int threads);
+void job_system_destroy(job_system_t *system);
+
+void job_counter_init(job_counter_t *counter);
+bool job_counter_done(job_counter_t *counter);
+
+// Queues a job, held back until after is done when given; every job signalling after must be queued before
+void job_run(job_system_t *system, job_t *job, job_counter_t *after);
+
+// Splits [0, count) into ranges of batch indexes, one job of jobs each (at least one, so an empty range
+// still orders the jobs after it). jobs needs room for max(1, (count + batch - 1) / batch) entries,
+// returns how many it used.
+int job_parallel_for(job_system_t *system, job_t *jobs, int count, int batch, job_fn fn, void *data,
+					 job_counter_t *done, job_counter_t *after);
+
+// Runs queued jobs until the counter is done
+void job_wait(job_system_t *system, job_counter_t *counter);
+
+#endif // JOB_H
@@ -0,0 +1,82 @@
+#include "mpmc_queue.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+bool mpmc_queue_init(mpmc_queue_t *queue, size_t capacity) {
+	// Round capacity up to a power of two so the index is a mask
+	size_t size = 2;
+	while (size < capacity)
+		size *= 2;
+
+	queue->cells = malloc(sizeof(mpmc_cell_t) * size);
+	if (!queue->cells) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for a queue of %zu cells.\n", size);
+		return false;
+	}
+	for (size_t i = 0; i < size; ++i) {
+		atomic_init(&queue->cells[i].sequence, i);
+		queue->cells[i].data = NULL;
+	}
+	queue->mask = size - 1;
+	atomic_init(&queue->tail, 0);
+	atomic_init(&queue->head, 0);
+	return true;
+}
+
+void mpmc_queue_destroy(mpmc_queue_t *queue) {
+	free(queue->cells);
+	queue->cells = NULL;
+}
+
+bool mpmc_queue_push(mpmc_queue_t *queue, void *data) {
+	size_t pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	mpmc_cell_t *cell;
+
+	for (;;) {
+		cell = &queue->cells[pos & queue->mask];
+		size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			// Cell is free, claim it
+			if (atomic_compare_exchange_weak_explicit(&queue->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			// Cell still holds data from the previous lap
+			return false;
+		} else {
+			pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+		}
+	}
+
+	cell->data = data;
+	atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+	return true;
+}
+
+bool mpmc_queue_pop(mpmc_queue_t *queue, void **data) {
+	size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	mpmc_cell_t *cell;
+
+	for (;;) {
+		cell = &queue->cells[pos & queue->mask];
+		size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+		if (diff == 0) {
+			// Cell is written, claim it
+			if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			// Nothing written yet
+			return false;
+		} else {
+			pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+		}
+	}
+
+	*data = cell->data;
+	atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+	return true;
+}
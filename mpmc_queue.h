@@ -0,0 +1,28 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bounded lock-free queue of pointers, safe for many producers and many consumers
+typedef struct {
+	atomic_size_t sequence;				// Tells producers/consumers whose turn the cell is
+	void *data;
+} mpmc_cell_t;
+
+typedef struct {
+	mpmc_cell_t *cells;
+	size_t mask;						// Capacity - 1, capacity is a power of two
+	_Alignas(64) atomic_size_t tail;	// Next cell to write, kept on its own cache line
+	_Alignas(64) atomic_size_t head;	// Next cell to read
+} mpmc_queue_t;
+
+bool mpmc_queue_init(mpmc_queue_t *queue, size_t capacity);
+void mpmc_queue_destroy(mpmc_queue_t *queue);
+
+// Both return false instead of blocking when the queue is full/empty
+bool mpmc_queue_push(mpmc_queue_t *queue, void *data);
+bool mpmc_queue_pop(mpmc_queue_t *queue, void **data);
+
+#endif // MPMC_QUEUE_H
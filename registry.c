@@ -0,0 +1,301 @@
+#include "registry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DISPLACEMENT 65536			// Seeds tried per bucket before the slot table doubles
+
+static uint32_t hash_name(const char *name, uint32_t seed) {
+	// FNV-1a started from the seed
+	uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+	for (; *name; ++name)
+		hash = (hash ^ (uint8_t)*name) * 16777619u;
+	return hash ^ (hash >> 15);
+}
+
+static uint32_t next_pow2(uint32_t value) {
+	uint32_t size = 1;
+	while (size < value)
+		size *= 2;
+	return size;
+}
+
+static const uint32_t *sort_buckets;
+static const int *sort_sizes;
+
+static int compare_buckets(const void *a, const void *b) {
+	// Biggest buckets first, they are the hardest to place
+	uint32_t bucket_a = sort_buckets[*(const int *)a], bucket_b = sort_buckets[*(const int *)b];
+	if (sort_sizes[bucket_a] != sort_sizes[bucket_b])
+		return sort_sizes[bucket_b] - sort_sizes[bucket_a];
+	return (bucket_a > bucket_b) - (bucket_a < bucket_b);
+}
+
+// Hash and displace: names are split in small buckets, and each bucket gets the
+// seed that sends all its names to free slots
+static bool build_hash(registry_t *registry) {
+	int n = registry->count;
+	uint32_t bucket_count = next_pow2((uint32_t)(n + 3) / 4);
+	uint32_t size = next_pow2((uint32_t)n + (uint32_t)n / 4 + 1);
+	uint32_t *buckets = malloc(sizeof(uint32_t) * n);
+	int *order = malloc(sizeof(int) * n);
+	int *sizes = calloc(bucket_count, sizeof(int));
+	bool ok = buckets && order && sizes;
+
+	for (int i = 0; ok && i < n; ++i) {
+		buckets[i] = hash_name(registry->species[i].name, 0) & (bucket_count - 1);
+		sizes[buckets[i]]++;
+		order[i] = i;
+	}
+	if (ok) {
+		sort_buckets = buckets;
+		sort_sizes = sizes;
+		qsort(order, (size_t)n, sizeof(int), compare_buckets);
+	}
+
+	for (bool placed = false; ok && !placed; size *= 2) {
+		int *slots = realloc(registry->slots, sizeof(int) * size);
+		uint32_t *seeds = realloc(registry->seeds, sizeof(uint32_t) * bucket_count);
+		if (slots)
+			registry->slots = slots;
+		if (seeds)
+			registry->seeds = seeds;
+		if (!slots || !seeds) {
+			ok = false;
+			break;
+		}
+		registry->slot_mask = size - 1;
+		registry->bucket_mask = bucket_count - 1;
+		for (uint32_t i = 0; i < size; ++i)
+			slots[i] = SPECIES_NONE;
+
+		placed = true;
+		for (int start = 0; start < n && placed; ) {
+			// Names of one bucket are next to each other in order
+			int end = start;
+			while (end < n && buckets[order[end]] == buckets[order[start]])
+				++end;
+
+			placed = false;
+			for (uint32_t seed = 1; seed < MAX_DISPLACEMENT && !placed; ++seed) {
+				int i = start;
+				for (; i < end; ++i) {
+					uint32_t slot = hash_name(registry->species[order[i]].name, seed) & registry->slot_mask;
+					if (slots[slot] != SPECIES_NONE)
+						break;
+					slots[slot] = order[i];
+				}
+				if (i == end) {
+					seeds[buckets[order[start]]] = seed;
+					placed = true;
+				} else {
+					// Undo the names of this bucket already placed
+					while (--i >= start)
+						slots[hash_name(registry->species[order[i]].name, seed) & registry->slot_mask] = SPECIES_NONE;
+				}
+			}
+			start = end;
+		}
+	}
+
+	if (!ok)
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for the species hash.\n");
+	free(buckets);
+	free(order);
+	free(sizes);
+	return ok;
+}
+
+static const anim_table_t *load_table(registry_t *registry, const char *path) {
+	if (strcmp(path, "builtin") == 0)
+		return &anim_builtin;
+
+	// Species sharing a layout share the table
+	for (int i = 0; i < registry->table_count; ++i)
+		if (strcmp(registry->table_paths[i], path) == 0)
+			return registry->tables[i];
+
+	anim_table_t *table = malloc(sizeof(anim_table_t));
+	if (!table)
+		return NULL;
+	if (!anim_table_load(table, path)) {
+		free(table);
+		return NULL;
+	}
+
+	anim_table_t **tables = realloc(registry->tables, sizeof(anim_table_t *) * (registry->table_count + 1));
+	if (tables)
+		registry->tables = tables;
+	char (*paths)[SPECIES_PATH_SIZE] = realloc(registry->table_paths, sizeof(*paths) * (registry->table_count + 1));
+	if (paths)
+		registry->table_paths = paths;
+	if (!tables || !paths) {
+		free(table);
+		return NULL;
+	}
+	registry->tables[registry->table_count] = table;
+	snprintf(registry->table_paths[registry->table_count], SPECIES_PATH_SIZE, "%s", path);
+	registry->table_count++;
+	return table;
+}
+
+static bool parse_line(registry_t *registry, const char *line, species_t *species) {
+	char clips[SPECIES_PATH_SIZE];
+	int fields = sscanf(line, "%31s %255s %255s %f %d", species->name, species->sheet, clips, &species->speed, &species->scale);
+	if (fields != 5 || species->speed < 0 || species->scale <= 0)
+		return false;
+	for (int i = 0; i < registry->count; ++i)
+		if (strcmp(registry->species[i].name, species->name) == 0)
+			return false;
+
+	species->anims = load_table(registry, clips);
+	species->atlas_sheet = -1;
+	species->region = ATLAS_REGION_NONE;
+	species->reloading = ATLAS_REGION_NONE;
+	return species->anims != NULL && collision_mask_init(&species->mask, species->anims, species->scale);
+}
+
+bool registry_load(registry_t *registry, const char *path) {
+	*registry = (registry_t){0};
+
+	size_t size;
+	char *text = SDL_LoadFile(path, &size);
+	if (!text) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read manifest %s: %s\n", path, SDL_GetError());
+		return false;
+	}
+
+	bool ok = true;
+	int number = 0;
+	for (char *line = text, *next; line && ok; line = next) {
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		++number;
+
+		line += strspn(line, " \t\r");
+		if (!*line || *line == '#')
+			continue;
+
+		species_t *species = realloc(registry->species, sizeof(species_t) * (registry->count + 1));
+		if (!species) {
+			ok = false;
+			break;
+		}
+		registry->species = species;
+		ok = parse_line(registry, line, &registry->species[registry->count]);
+		if (ok)
+			registry->count++;
+	}
+	SDL_free(text);
+
+	if (!ok || registry->count == 0 || !build_hash(registry)) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Invalid manifest %s at line %d\n", path, number);
+		registry_destroy(registry);
+		return false;
+	}
+	SDL_Log("Registered %d species from %s\n", registry->count, path);
+	return true;
+}
+
+void registry_destroy(registry_t *registry) {
+	for (int i = 0; i < registry->table_count; ++i)
+		free(registry->tables[i]);
+	free(registry->tables);
+	free(registry->table_paths);
+	for (int i = 0; i < registry->count; ++i)
+		collision_mask_destroy(&registry->species[i].mask);
+	free(registry->species);
+	free(registry->slots);
+	free(registry->seeds);
+	*registry = (registry_t){0};
+}
+
+const species_t *registry_get(const registry_t *registry, int id) {
+	if (id < 0 || id >= registry->count)
+		return NULL;
+	return &registry->species[id];
+}
+
+int registry_find(const registry_t *registry, const char *name) {
+	if (!registry->slots)
+		return SPECIES_NONE;
+	uint32_t seed = registry->seeds[hash_name(name, 0) & registry->bucket_mask];
+	int id = registry->slots[hash_name(name, seed) & registry->slot_mask];
+	if (id == SPECIES_NONE || strcmp(registry->species[id].name, name) != 0)
+		return SPECIES_NONE;
+	return id;
+}
+
+int registry_sheet(registry_t *registry, int id, atlas_pages_t *pages, asset_loader_t *loader) {
+	species_t *species = &registry->species[id];
+	species->wanted = true;
+	if (!species->requested && !species->given_up) {
+		// A full loader queue or page only delays the sheet
+		species->region = atlas_pages_add_async(pages, loader, species->sheet);
+		species->requested = species->region != ATLAS_REGION_NONE;
+		if (species->requested)
+			SDL_Log("Loading sheet of %s\n", species->name);
+	}
+	return species->region;
+}
+
+void registry_retry(registry_t *registry, atlas_pages_t *pages, asset_loader_t *loader) {
+	for (int i = 0; i < registry->count; ++i) {
+		species_t *species = &registry->species[i];
+		if (atlas_pages_failed(pages, species->reloading)) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not reload sheet of %s, keeping the old one\n", species->name);
+			atlas_pages_free(pages, species->reloading);
+			species->reloading = ATLAS_REGION_NONE;
+		}
+		if (species->requested && atlas_pages_failed(pages, species->region)) {
+			atlas_pages_free(pages, species->region);
+			species->region = ATLAS_REGION_NONE;
+			species->requested = false;
+			species->given_up = ++species->attempts == SPECIES_SHEET_ATTEMPTS;
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not load sheet of %s (attempt %d of %d)%s\n", species->name,
+						 species->attempts, SPECIES_SHEET_ATTEMPTS, species->given_up ? ", giving up" : "");
+		}
+		if (species->wanted && !species->requested)
+			registry_sheet(registry, i, pages, loader);
+	}
+}
+
+int registry_reload(registry_t *registry, const char *path, atlas_pages_t *pages, asset_loader_t *loader) {
+	int count = 0;
+	for (int i = 0; i < registry->count; ++i) {
+		species_t *species = &registry->species[i];
+		if (strcmp(species->sheet, path) != 0)
+			continue;
+
+		// Packed sheets are stale once edited, the page region takes over as soon as it is uploaded.
+		// Loaded ones are drawn until the new region is, an earlier reload still loading is dropped.
+		SDL_Log("Reloading sheet of %s\n", species->name);
+		species->attempts = 0;
+		species->given_up = false;
+		if (!species->requested) {
+			registry_sheet(registry, i, pages, loader);
+		} else {
+			atlas_pages_free(pages, species->reloading);
+			species->reloading = atlas_pages_add_async(pages, loader, species->sheet);
+		}
+		++count;
+	}
+	return count;
+}
+
+void registry_sheet_loaded(registry_t *registry, int region, const SDL_Surface *surface, atlas_pages_t *pages) {
+	for (int i = 0; i < registry->count; ++i) {
+		species_t *species = &registry->species[i];
+		if (!species->requested)
+			continue;
+		if (species->reloading == region) {
+			atlas_pages_free(pages, species->region);
+			species->region = region;
+			species->reloading = ATLAS_REGION_NONE;
+		}
+		if (species->region == region)
+			collision_mask_from_surface(&species->mask, surface);
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "anim.h"
+#include "asset_loader.h"
+#include "atlas_pages.h"
+#include "collision_mask.h"
+
+#define SPECIES_NAME_SIZE 32
+#define SPECIES_PATH_SIZE 256
+#define SPECIES_NONE (-1)
+#define SPECIES_SHEET_ATTEMPTS 3			// Loads of a sheet that failed before it is given up until edited
+
+// One kind of animal as described by the manifest
+typedef struct {
+	char name[SPECIES_NAME_SIZE];
+	char sheet[SPECIES_PATH_SIZE];		// Image of the sheet, loaded on first use
+	const anim_table_t *anims;			// Clips of the sheet
+	float speed;
+	int scale;							// Screen pixels per sheet pixel
+	int atlas_sheet;					// Sheet in the sprite pack atlas, -1 when the species is not packed
+	int region;							// Atlas page region once the sheet is requested, drawn before the pack
+	int reloading;						// Region of an edited sheet still loading, replaces region once uploaded
+	collision_mask_t mask;				// Opaque pixels of the sheet at the species scale, read with its pixels
+	bool wanted;						// Some actor needs the sheet from the pages
+	bool requested;						// The loader accepted the request of the sheet
+	int attempts;						// Requests of the sheet that failed to load
+	bool given_up;						// The sheet failed every attempt, drawn from the pack or the placeholder
+} species_t;
+
+// Every species of the manifest, ids are their order in the file
+typedef struct {
+	species_t *species;
+	int count;
+	anim_table_t **tables;				// Animation tables read from metadata files
+	char (*table_paths)[SPECIES_PATH_SIZE];
+	int table_count;
+
+	// Perfect hash of the names: every name lands in its own slot
+	uint32_t *seeds;					// Seed of the second hash, per bucket of the first one
+	uint32_t bucket_mask;
+	int *slots;							// Species id of each slot, SPECIES_NONE when empty
+	uint32_t slot_mask;
+} registry_t;
+
+// Reads the manifest, one species per line: name sheet clips speed scale
+// where clips is "builtin" or the path of an animation table
+bool registry_load(registry_t *registry, const char *path);
+void registry_destroy(registry_t *registry);
+
+// O(1) lookups, NULL/SPECIES_NONE when missing
+const species_t *registry_get(const registry_t *registry, int id);
+int registry_find(const registry_t *registry, const char *name);
+
+// Region of the species sheet in the atlas pages, requested from the loader the first time.
+// ATLAS_REGION_NONE when the loader could not take the request, registry_retry asks again.
+int registry_sheet(registry_t *registry, int id, atlas_pages_t *pages, asset_loader_t *loader);
+// Requests again the wanted sheets whose request was refused or whose image failed to load,
+// a few times at most. A reloaded sheet that fails keeps the old one.
+void registry_retry(registry_t *registry, atlas_pages_t *pages, asset_loader_t *loader);
+
+// Decodes again every sheet loaded from path into a new region, returns how many species use it.
+// Sheets given up are tried again.
+int registry_reload(registry_t *registry, const char *path, atlas_pages_t *pages, asset_loader_t *loader);
+// Sheet of a region uploaded: reads the collision mask of its species, a reloaded sheet takes the place of
+// the old one whose region is freed
+void registry_sheet_loaded(registry_t *registry, int region, const SDL_Surface *surface, atlas_pages_t *pages);
+
+#endif // REGISTRY_H
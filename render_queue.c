@@ -0,0 +1,139 @@
+#include "render_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define KEY_DIGITS (64 / RADIX_BITS)
+#define SEQUENCE_DIGITS (RENDER_SEQUENCE_BITS / RADIX_BITS)
+
+#define DEPTH_SHIFT RENDER_SEQUENCE_BITS
+#define TEXTURE_SHIFT (DEPTH_SHIFT + RENDER_DEPTH_BITS)
+#define LAYER_SHIFT (TEXTURE_SHIFT + RENDER_TEXTURE_BITS)
+#define MASK(bits) ((1ull << (bits)) - 1)
+
+static bool resize(void **array, int capacity, size_t item_size) {
+	void *items = realloc(*array, item_size * capacity);
+	if (!items)
+		return false;
+	*array = items;
+	return true;
+}
+
+bool render_queue_init(render_queue_t *queue) {
+	*queue = (render_queue_t){0};
+	return true;
+}
+
+void render_queue_destroy(render_queue_t *queue) {
+	free(queue->items);
+	free(queue->keys);
+	free(queue->scratch);
+	*queue = (render_queue_t){0};
+}
+
+// Float bits flipped so that unsigned order is float order, negatives included
+static uint32_t depth_bits(float depth) {
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+bool render_queue_submit(render_queue_t *queue, int layer, float depth, int texture, const SDL_Rect *src,
+						 const SDL_FRect *dest, SDL_Color tint, SDL_RendererFlip flip) {
+	if (queue->count == queue->capacity) {
+		if (queue->capacity == RENDER_QUEUE_MAX)
+			return false;
+		int capacity = queue->capacity ? SDL_min(queue->capacity * 2, RENDER_QUEUE_MAX) : 1024;
+		if (!resize((void **)&queue->items, capacity, sizeof(render_item_t)) ||
+			!resize((void **)&queue->keys, capacity, sizeof(uint64_t)) ||
+			!resize((void **)&queue->scratch, capacity, sizeof(uint64_t)))
+			return false;
+		queue->capacity = capacity;
+	}
+
+	const int sequence = queue->count++;
+	queue->items[sequence] = (render_item_t){
+		.texture = texture,
+		.src = src ? *src : (SDL_Rect){0},
+		.whole = !src,
+		.dest = *dest,
+		.tint = tint,
+		.flip = flip,
+	};
+	queue->keys[sequence] = ((uint64_t)(layer & MASK(RENDER_LAYER_BITS)) << LAYER_SHIFT) |
+							((uint64_t)(texture & MASK(RENDER_TEXTURE_BITS)) << TEXTURE_SHIFT) |
+							((uint64_t)(depth_bits(depth) >> (32 - RENDER_DEPTH_BITS)) << DEPTH_SHIFT) |
+							(uint64_t)sequence;
+	return true;
+}
+
+void render_queue_sort(render_queue_t *queue) {
+	const int count = queue->count;
+	if (count < 2)
+		return;
+
+	// Every digit counted in one pass over the keys
+	int histogram[KEY_DIGITS][RADIX_SIZE] = {0};
+	for (int i = 0; i < count; ++i)
+		for (int digit = SEQUENCE_DIGITS; digit < KEY_DIGITS; ++digit)
+			++histogram[digit][(queue->keys[i] >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1)];
+
+	// Keys are submitted in sequence order, so the sequence digits are already sorted.
+	// Digits every key shares (one layer, one texture...) leave the order as it is and are skipped.
+	uint64_t *keys = queue->keys, *sorted = queue->scratch;
+	for (int digit = SEQUENCE_DIGITS; digit < KEY_DIGITS; ++digit) {
+		int *counts = histogram[digit];
+		const int shift = digit * RADIX_BITS;
+		if (counts[(keys[0] >> shift) & (RADIX_SIZE - 1)] == count)
+			continue;
+
+		int offset = 0;
+		for (int bucket = 0; bucket < RADIX_SIZE; ++bucket) {
+			int n = counts[bucket];
+			counts[bucket] = offset;
+			offset += n;
+		}
+		for (int i = 0; i < count; ++i)
+			sorted[counts[(keys[i] >> shift) & (RADIX_SIZE - 1)]++] = keys[i];
+
+		uint64_t *swap = keys;
+		keys = sorted;
+		sorted = swap;
+	}
+	queue->keys = keys;
+	queue->scratch = sorted;
+}
+
+const render_item_t *render_queue_item(const render_queue_t *queue, int i) {
+	return &queue->items[queue->keys[i] & MASK(RENDER_SEQUENCE_BITS)];
+}
+
+void render_queue_draw(const render_queue_t *queue, texture_cache_t *cache, sprite_batch_t *batch, const SDL_Rect *clip) {
+	// Sorted keys come in runs of one texture, look each run up once
+	int texture = TEXTURE_NONE;
+	SDL_Texture *current = NULL;
+	const SDL_FRect bounds = clip ? (SDL_FRect){(float)clip->x, (float)clip->y, (float)clip->w, (float)clip->h} : (SDL_FRect){0};
+	for (int i = 0; i < queue->count; ++i) {
+		const render_item_t *item = render_queue_item(queue, i);
+		if (clip && !SDL_HasIntersectionF(&item->dest, &bounds))
+			continue;
+		if (item->texture != texture) {
+			texture = item->texture;
+			current = texture_cache_get(cache, texture);
+		}
+		if (current)
+			sprite_batch_add(batch, current, item->whole ? NULL : &item->src, &item->dest, item->tint, item->flip);
+	}
+}
+
+void render_queue_clear(render_queue_t *queue) {
+	queue->count = 0;
+}
+
+void render_queue_drain(render_queue_t *queue, texture_cache_t *cache, sprite_batch_t *batch) {
+	render_queue_sort(queue);
+	render_queue_draw(queue, cache, batch, NULL);
+	render_queue_clear(queue);
+}
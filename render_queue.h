@@ -0,0 +1,54 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL.h>
+
+#include "sprite_batch.h"
+#include "texture_cache.h"
+
+// Sort key, from the most significant bits: layer | texture id | y-depth | sequence
+#define RENDER_LAYER_BITS 4
+#define RENDER_TEXTURE_BITS 12				// Texture ids past this share keys, they are still drawn in order
+#define RENDER_DEPTH_BITS 24				// Top bits of the depth as an ordered integer
+#define RENDER_SEQUENCE_BITS 24				// Submission index, also finds the sprite of a key
+#define RENDER_LAYERS (1 << RENDER_LAYER_BITS)
+#define RENDER_QUEUE_MAX (1 << RENDER_SEQUENCE_BITS)
+
+// Sprite waiting for its turn
+typedef struct {
+	int texture;							// Cached texture id
+	SDL_Rect src;
+	bool whole;								// Draws all the texture, src is ignored
+	SDL_FRect dest;
+	SDL_Color tint;
+	SDL_RendererFlip flip;
+} render_item_t;
+
+// Sprites of a frame sorted once before drawing: layers in order, then as few texture switches as possible,
+// then back to front by depth. Sprites of the same layer and texture never interleave with other textures.
+typedef struct {
+	render_item_t *items;					// In submission order
+	uint64_t *keys, *scratch;
+	int count, capacity;
+} render_queue_t;
+
+bool render_queue_init(render_queue_t *queue);
+void render_queue_destroy(render_queue_t *queue);
+
+// Queues a sprite, depth is usually the y of its feet. False when the queue is full or out of memory.
+bool render_queue_submit(render_queue_t *queue, int layer, float depth, int texture, const SDL_Rect *src,
+						 const SDL_FRect *dest, SDL_Color tint, SDL_RendererFlip flip);
+// Sorts the keys with an LSD radix sort
+void render_queue_sort(render_queue_t *queue);
+// Sprite at index i of the key order, call after render_queue_sort
+const render_item_t *render_queue_item(const render_queue_t *queue, int i);
+// Adds the sprites touching clip (NULL for all) to the batch in key order, call after render_queue_sort
+void render_queue_draw(const render_queue_t *queue, texture_cache_t *cache, sprite_batch_t *batch, const SDL_Rect *clip);
+void render_queue_clear(render_queue_t *queue);
+// Sorts, adds every sprite to the batch in key order and empties the queue, the batch is not flushed
+void render_queue_drain(render_queue_t *queue, texture_cache_t *cache, sprite_batch_t *batch);
+
+#endif // RENDER_QUEUE_H
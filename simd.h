@@ -0,0 +1,86 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <SDL.h>
+
+// CPU dispatch of the kernels. A module writes a scalar kernel and, where the compiler can build them,
+// SSE2 and AVX2 kernels of the same type: SSE2 ones inside #ifdef SIMD_SSE2, AVX2 ones inside
+// #ifdef SIMD_AVX2 marked SIMD_TARGET_AVX2. SIMD_DECLARE in its header and SIMD_DEFINE in its source
+// then give, for a prefix and a kernel type:
+//   int prefix_variants(type variants[SIMD_VARIANTS])	every kernel the CPU runs, the scalar one first and
+//														the fastest last, returns how many
+//   type prefix_select(void)							the fastest of them, called once at startup
+//   const char *prefix_name(type kernel)				"scalar", "SSE2", "AVX2" or "unknown"
+// Every variant gives the same result as the scalar one, tests compare them through TEST_VARIANTS.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define SIMD_X86
+#include <immintrin.h>
+#ifdef __SSE2__
+#define SIMD_SSE2
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_AVX2
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#define SIMD_VARIANTS 3					// Scalar, SSE2, AVX2
+
+// Any kernel, cast back to its own type before the call
+typedef void (*simd_kernel_t)(void);
+
+// Kernel that was not built is NULL, its name is not even expanded
+#ifdef SIMD_SSE2
+#define SIMD_IF_SSE2(kernel) (simd_kernel_t)(kernel)
+#else
+#define SIMD_IF_SSE2(kernel) NULL
+#endif
+#ifdef SIMD_AVX2
+#define SIMD_IF_AVX2(kernel) (simd_kernel_t)(kernel)
+#else
+#define SIMD_IF_AVX2(kernel) NULL
+#endif
+
+// Kernels of the table that were built and that the CPU runs, in table order
+static inline int simd_variants(const simd_kernel_t kernels[SIMD_VARIANTS], simd_kernel_t variants[SIMD_VARIANTS]) {
+	int count = 0;
+	variants[count++] = kernels[0];
+	if (kernels[1] && SDL_HasSSE2())
+		variants[count++] = kernels[1];
+	if (kernels[2] && SDL_HasAVX2())
+		variants[count++] = kernels[2];
+	return count;
+}
+
+static inline const char *simd_name(const simd_kernel_t kernels[SIMD_VARIANTS], simd_kernel_t kernel) {
+	static const char *const names[SIMD_VARIANTS] = {"scalar", "SSE2", "AVX2"};
+	for (int i = 0; i < SIMD_VARIANTS; ++i)
+		if (kernel && kernel == kernels[i])
+			return names[i];
+	return "unknown";
+}
+
+#define SIMD_DECLARE(prefix, type) \
+	int prefix##_variants(type variants[SIMD_VARIANTS]); \
+	type prefix##_select(void); \
+	const char *prefix##_name(type kernel)
+
+#define SIMD_DEFINE(prefix, type, scalar, sse2, avx2) \
+	static const simd_kernel_t prefix##_kernels[SIMD_VARIANTS] = {(simd_kernel_t)(scalar), SIMD_IF_SSE2(sse2), SIMD_IF_AVX2(avx2)}; \
+	int prefix##_variants(type variants[SIMD_VARIANTS]) { \
+		simd_kernel_t kernels[SIMD_VARIANTS]; \
+		int count = simd_variants(prefix##_kernels, kernels); \
+		for (int i = 0; i < count; ++i) \
+			variants[i] = (type)kernels[i]; \
+		return count; \
+	} \
+	type prefix##_select(void) { \
+		type variants[SIMD_VARIANTS]; \
+		return variants[prefix##_variants(variants) - 1]; \
+	} \
+	const char *prefix##_name(type kernel) { \
+		return simd_name(prefix##_kernels, (simd_kernel_t)kernel); \
+	}
+
+#endif // SIMD_H
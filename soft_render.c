@@ -0,0 +1,350 @@
+#include "soft_render.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BACKGROUND 0xFF000000u				// Opaque black, as SDL_RenderClear leaves it
+
+static bool resize(void **array, int capacity, size_t item_size) {
+	void *items = realloc(*array, item_size * capacity);
+	if (!items)
+		return false;
+	*array = items;
+	return true;
+}
+
+// Premultiplied source over destination, each channel is d * (255 - a) / 255 rounded, plus s.
+// Every variant computes exactly this.
+static uint32_t blend(uint32_t s, uint32_t d) {
+	uint32_t inverse = 255 - (s >> 24), out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint32_t t = ((d >> shift) & 0xFF) * inverse + 128;
+		uint32_t c = ((s >> shift) & 0xFF) + ((t + (t >> 8)) >> 8);
+		out |= SDL_min(c, 255u) << shift;
+	}
+	return out;
+}
+
+static void span_scalar(uint32_t *dst, const uint32_t *row, const int *columns, int count) {
+	for (int i = 0; i < count; ++i)
+		dst[i] = blend(row[columns[i]], dst[i]);
+}
+
+// Colour and alpha modulation of a premultiplied pixel, the tint colour is weighted by its alpha
+static uint32_t modulate(uint32_t s, SDL_Color tint) {
+	const uint32_t factors[4] = {(uint32_t)tint.b * tint.a, (uint32_t)tint.g * tint.a, (uint32_t)tint.r * tint.a, (uint32_t)tint.a * 255};
+	uint32_t out = 0;
+	for (int k = 0; k < 4; ++k) {
+		uint32_t c = ((s >> (k * 8)) & 0xFF) * factors[k] / (255 * 255);
+		out |= c << (k * 8);
+	}
+	return out;
+}
+
+static void span_tinted(uint32_t *dst, const uint32_t *row, const int *columns, int count, SDL_Color tint) {
+	for (int i = 0; i < count; ++i)
+		dst[i] = blend(modulate(row[columns[i]], tint), dst[i]);
+}
+
+#ifdef SIMD_X86
+// Pixels are widened to 16-bit channels, the alpha of each pixel is copied over its four channels.
+// d * (255 - a) + 128 stays below 65536, so the rounding of the scalar blend fits the lanes.
+
+#ifdef SIMD_SSE2
+static __m128i blend_sse2(__m128i s, __m128i d) {
+	const __m128i zero = _mm_setzero_si128(), full = _mm_set1_epi16(255), half = _mm_set1_epi16(128);
+	__m128i s_lo = _mm_unpacklo_epi8(s, zero), s_hi = _mm_unpackhi_epi8(s, zero);
+	__m128i inverse_lo = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, 0xFF), 0xFF));
+	__m128i inverse_hi = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, 0xFF), 0xFF));
+	__m128i t_lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inverse_lo), half);
+	__m128i t_hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inverse_hi), half);
+	t_lo = _mm_srli_epi16(_mm_add_epi16(t_lo, _mm_srli_epi16(t_lo, 8)), 8);
+	t_hi = _mm_srli_epi16(_mm_add_epi16(t_hi, _mm_srli_epi16(t_hi, 8)), 8);
+	return _mm_adds_epu8(_mm_packus_epi16(t_lo, t_hi), s);
+}
+
+static void span_sse2(uint32_t *dst, const uint32_t *row, const int *columns, int count) {
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_setr_epi32((int)row[columns[i]], (int)row[columns[i + 1]], (int)row[columns[i + 2]], (int)row[columns[i + 3]]);
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		_mm_storeu_si128((__m128i *)(dst + i), blend_sse2(s, d));
+	}
+	span_scalar(dst + i, row, columns + i, count - i);
+}
+#endif
+
+#ifdef SIMD_AVX2
+
+// Unpacking and packing both work inside 128-bit lanes, so pixels come back in order
+SIMD_TARGET_AVX2
+static void span_avx2(uint32_t *dst, const uint32_t *row, const int *columns, int count) {
+	const __m256i zero = _mm256_setzero_si256(), full = _mm256_set1_epi16(255), half = _mm256_set1_epi16(128);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_i32gather_epi32((const int *)row, _mm256_loadu_si256((const __m256i *)(columns + i)), 4);
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+		__m256i s_lo = _mm256_unpacklo_epi8(s, zero), s_hi = _mm256_unpackhi_epi8(s, zero);
+		__m256i inverse_lo = _mm256_sub_epi16(full, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_lo, 0xFF), 0xFF));
+		__m256i inverse_hi = _mm256_sub_epi16(full, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_hi, 0xFF), 0xFF));
+		__m256i t_lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inverse_lo), half);
+		__m256i t_hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inverse_hi), half);
+		t_lo = _mm256_srli_epi16(_mm256_add_epi16(t_lo, _mm256_srli_epi16(t_lo, 8)), 8);
+		t_hi = _mm256_srli_epi16(_mm256_add_epi16(t_hi, _mm256_srli_epi16(t_hi, 8)), 8);
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_adds_epu8(_mm256_packus_epi16(t_lo, t_hi), s));
+	}
+	span_scalar(dst + i, row, columns + i, count - i);
+}
+#endif
+#endif // SIMD_X86
+
+SIMD_DEFINE(soft_span, soft_span_fn, span_scalar, span_sse2, span_avx2)
+
+// The id of an evicted texture is given to the next one inserted, its copy must not outlive it
+static void drop_image(void *userdata, int texture) {
+	soft_render_t *soft = userdata;
+	if (texture >= soft->image_count)
+		return;
+	free(soft->images[texture].pixels);
+	soft->images[texture] = (soft_image_t){0};
+}
+
+bool soft_render_init(soft_render_t *soft, texture_cache_t *cache) {
+	*soft = (soft_render_t){.cache = cache, .span = soft_span_select()};
+	cache->on_evict = drop_image;
+	cache->evict_userdata = soft;
+	return true;
+}
+
+void soft_render_destroy(soft_render_t *soft) {
+	if (soft->cache && soft->cache->evict_userdata == soft) {
+		soft->cache->on_evict = NULL;
+		soft->cache->evict_userdata = NULL;
+	}
+	for (int i = 0; i < soft->image_count; ++i)
+		free(soft->images[i].pixels);
+	free(soft->images);
+	free(soft->sprites);
+	free(soft->bins);
+	free(soft->tile_first);
+	free(soft->jobs);
+	if (soft->frame)
+		SDL_DestroyTexture(soft->frame);
+	*soft = (soft_render_t){0};
+}
+
+// CPU copy of a texture, made the size of the texture on first use
+static soft_image_t *get_image(soft_render_t *soft, int texture) {
+	if (texture < 0)
+		return NULL;
+	if (texture >= soft->image_count) {
+		if (!resize((void **)&soft->images, texture + 1, sizeof(soft_image_t)))
+			return NULL;
+		memset(soft->images + soft->image_count, 0, sizeof(soft_image_t) * (texture + 1 - soft->image_count));
+		soft->image_count = texture + 1;
+	}
+
+	soft_image_t *image = &soft->images[texture];
+	if (!image->pixels) {
+		int w, h;
+		SDL_Texture *gpu = texture_cache_get(soft->cache, texture);
+		if (!gpu || SDL_QueryTexture(gpu, NULL, NULL, &w, &h) != 0)
+			return NULL;
+		image->pixels = calloc((size_t)w * h, sizeof(uint32_t));
+		if (!image->pixels)
+			return NULL;
+		image->w = w;
+		image->h = h;
+	}
+	return image;
+}
+
+bool soft_render_upload(soft_render_t *soft, int texture, int x, int y, const SDL_Surface *surface) {
+	soft_image_t *image = get_image(soft, texture);
+	if (!image || x < 0 || y < 0 || x + surface->w > image->w || y + surface->h > image->h)
+		return false;
+
+	// Pixels are only read, locking a surface changes nothing but its lock count
+	SDL_Surface *source = (SDL_Surface *)surface;
+	SDL_Surface *converted = source->format->format == SDL_PIXELFORMAT_ARGB8888 ? source : SDL_ConvertSurfaceFormat(source, SDL_PIXELFORMAT_ARGB8888, 0);
+	if (!converted || SDL_LockSurface(converted) != 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Could not convert pixels for the software renderer: %s\n", SDL_GetError());
+		if (converted && converted != source)
+			SDL_FreeSurface(converted);
+		return false;
+	}
+	int result = SDL_PremultiplyAlpha(converted->w, converted->h, SDL_PIXELFORMAT_ARGB8888, converted->pixels, converted->pitch,
+									  SDL_PIXELFORMAT_ARGB8888, image->pixels + (size_t)y * image->w + x, image->w * (int)sizeof(uint32_t));
+	SDL_UnlockSurface(converted);
+	if (converted != source)
+		SDL_FreeSurface(converted);
+	return result == 0;
+}
+
+// Streaming texture of the frame and tile tables, remade when the size changes
+static bool set_size(soft_render_t *soft, int width, int height) {
+	if (soft->frame && soft->width == width && soft->height == height)
+		return true;
+	if (width <= 0 || height <= 0)
+		return false;
+
+	const int tiles_x = (width + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE, tiles_y = (height + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+	if (tiles_x * tiles_y > soft->tile_capacity) {
+		if (!resize((void **)&soft->tile_first, tiles_x * tiles_y + 1, sizeof(int)) ||
+			!resize((void **)&soft->jobs, tiles_x * tiles_y, sizeof(job_t)))
+			return false;
+		soft->tile_capacity = tiles_x * tiles_y;
+	}
+
+	if (soft->frame)
+		SDL_DestroyTexture(soft->frame);
+	soft->frame = SDL_CreateTexture(soft->cache->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+	if (!soft->frame) {
+		SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Could not create software frame: %s\n", SDL_GetError());
+		return false;
+	}
+	soft->width = width;
+	soft->height = height;
+	soft->tiles_x = tiles_x;
+	soft->tiles_y = tiles_y;
+	return true;
+}
+
+// Places the sprites on the screen in draw order, those without pixels or off the screen are left out
+static bool place_sprites(soft_render_t *soft, const render_queue_t *queue) {
+	if (queue->count > soft->sprite_capacity) {
+		if (!resize((void **)&soft->sprites, queue->count, sizeof(soft_sprite_t)))
+			return false;
+		soft->sprite_capacity = queue->count;
+	}
+
+	const SDL_Rect screen = {0, 0, soft->width, soft->height};
+	soft->sprite_count = 0;
+	for (int i = 0; i < queue->count; ++i) {
+		const render_item_t *item = render_queue_item(queue, i);
+		const soft_image_t *image = item->texture >= 0 && item->texture < soft->image_count ? &soft->images[item->texture] : NULL;
+		if (!image || !image->pixels || item->dest.w <= 0 || item->dest.h <= 0)
+			continue;
+
+		const SDL_Rect whole = {0, 0, image->w, image->h};
+		SDL_Rect src;
+		if (!SDL_IntersectRect(item->whole ? &whole : &item->src, &whole, &src))
+			continue;
+
+		// Pixel centres inside the destination, as nearest-neighbour scaling samples them
+		int x0 = (int)SDL_ceilf(item->dest.x - 0.5f), y0 = (int)SDL_ceilf(item->dest.y - 0.5f);
+		int x1 = (int)SDL_ceilf(item->dest.x + item->dest.w - 0.5f), y1 = (int)SDL_ceilf(item->dest.y + item->dest.h - 0.5f);
+		SDL_Rect bounds = {x0, y0, x1 - x0, y1 - y0};
+		if (!SDL_IntersectRect(&bounds, &screen, &bounds))
+			continue;
+
+		soft->sprites[soft->sprite_count++] = (soft_sprite_t){
+			.image = image,
+			.bounds = bounds,
+			.dest = item->dest,
+			.src = src,
+			.scale_x = src.w / item->dest.w,
+			.scale_y = src.h / item->dest.h,
+			.tint = item->tint,
+			.flip = item->flip,
+		};
+	}
+	return true;
+}
+
+// Counting sort of the sprites into the tiles they touch, each tile keeps the draw order
+static bool bin_sprites(soft_render_t *soft) {
+	const int tile_count = soft->tiles_x * soft->tiles_y;
+	int *first = soft->tile_first;
+	memset(first, 0, sizeof(int) * (tile_count + 1));
+	for (int i = 0; i < soft->sprite_count; ++i) {
+		const SDL_Rect *b = &soft->sprites[i].bounds;
+		for (int ty = b->y / SOFT_TILE_SIZE; ty <= (b->y + b->h - 1) / SOFT_TILE_SIZE; ++ty)
+			for (int tx = b->x / SOFT_TILE_SIZE; tx <= (b->x + b->w - 1) / SOFT_TILE_SIZE; ++tx)
+				++first[ty * soft->tiles_x + tx + 1];
+	}
+	for (int t = 0; t < tile_count; ++t)
+		first[t + 1] += first[t];
+
+	const int total = first[tile_count];
+	if (total > soft->bin_capacity) {
+		if (!resize((void **)&soft->bins, total, sizeof(int)))
+			return false;
+		soft->bin_capacity = total;
+	}
+
+	// Filling moves each start to the start of the next tile, shifted back after
+	for (int i = 0; i < soft->sprite_count; ++i) {
+		const SDL_Rect *b = &soft->sprites[i].bounds;
+		for (int ty = b->y / SOFT_TILE_SIZE; ty <= (b->y + b->h - 1) / SOFT_TILE_SIZE; ++ty)
+			for (int tx = b->x / SOFT_TILE_SIZE; tx <= (b->x + b->w - 1) / SOFT_TILE_SIZE; ++tx)
+				soft->bins[first[ty * soft->tiles_x + tx]++] = i;
+	}
+	memmove(first + 1, first, sizeof(int) * tile_count);
+	first[0] = 0;
+	return true;
+}
+
+// Source row or column of a screen pixel, mirrored when flipped
+static int sample(int pixel, float dest, float scale, int size, bool flipped) {
+	int offset = (int)((pixel + 0.5f - dest) * scale);
+	offset = SDL_min(SDL_max(offset, 0), size - 1);
+	return flipped ? size - 1 - offset : offset;
+}
+
+static void draw_tile(soft_render_t *soft, int tile) {
+	const int tile_x = tile % soft->tiles_x * SOFT_TILE_SIZE, tile_y = tile / soft->tiles_x * SOFT_TILE_SIZE;
+	const int tile_w = SDL_min(SOFT_TILE_SIZE, soft->width - tile_x), tile_h = SDL_min(SOFT_TILE_SIZE, soft->height - tile_y);
+	uint32_t *pixels = soft->target + (size_t)tile_y * soft->target_pitch + tile_x;
+	for (int y = 0; y < tile_h; ++y)
+		SDL_memset4(pixels + (size_t)y * soft->target_pitch, BACKGROUND, tile_w);
+
+	int columns[SOFT_TILE_SIZE];
+	for (int b = soft->tile_first[tile]; b < soft->tile_first[tile + 1]; ++b) {
+		const soft_sprite_t *sprite = &soft->sprites[soft->bins[b]];
+		const int x0 = SDL_max(sprite->bounds.x, tile_x), x1 = SDL_min(sprite->bounds.x + sprite->bounds.w, tile_x + tile_w);
+		const int y0 = SDL_max(sprite->bounds.y, tile_y), y1 = SDL_min(sprite->bounds.y + sprite->bounds.h, tile_y + tile_h);
+		const bool tinted = sprite->tint.r != 255 || sprite->tint.g != 255 || sprite->tint.b != 255 || sprite->tint.a != 255;
+
+		for (int x = x0; x < x1; ++x)
+			columns[x - x0] = sprite->src.x + sample(x, sprite->dest.x, sprite->scale_x, sprite->src.w, sprite->flip & SDL_FLIP_HORIZONTAL);
+		for (int y = y0; y < y1; ++y) {
+			int v = sprite->src.y + sample(y, sprite->dest.y, sprite->scale_y, sprite->src.h, sprite->flip & SDL_FLIP_VERTICAL);
+			const uint32_t *row = sprite->image->pixels + (size_t)v * sprite->image->w;
+			uint32_t *dst = soft->target + (size_t)y * soft->target_pitch + x0;
+			if (tinted)
+				span_tinted(dst, row, columns, x1 - x0, sprite->tint);
+			else
+				soft->span(dst, row, columns, x1 - x0);
+		}
+	}
+}
+
+static void draw_tiles(void *data, int begin, int end) {
+	for (int tile = begin; tile < end; ++tile)
+		draw_tile(data, tile);
+}
+
+SDL_Texture *soft_render_draw(soft_render_t *soft, const render_queue_t *queue, job_system_t *jobs, int width, int height) {
+	if (!set_size(soft, width, height) || !place_sprites(soft, queue) || !bin_sprites(soft))
+		return NULL;
+
+	void *pixels;
+	int pitch;
+	if (SDL_LockTexture(soft->frame, NULL, &pixels, &pitch) != 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Could not lock software frame: %s\n", SDL_GetError());
+		return NULL;
+	}
+	soft->target = pixels;
+	soft->target_pitch = pitch / (int)sizeof(uint32_t);
+
+	// Tiles share no pixels, every job owns the tiles it draws
+	job_counter_t done;
+	job_counter_init(&done);
+	job_parallel_for(jobs, soft->jobs, soft->tiles_x * soft->tiles_y, 1, draw_tiles, soft, &done, NULL);
+	job_wait(jobs, &done);
+
+	SDL_UnlockTexture(soft->frame);
+	soft->target = NULL;
+	return soft->frame;
+}
@@ -0,0 +1,69 @@
+#ifndef SOFT_RENDER_H
+#define SOFT_RENDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL.h>
+
+#include "job.h"
+#include "render_queue.h"
+#include "simd.h"
+#include "texture_cache.h"
+
+#define SOFT_TILE_SIZE 128					// Screen tiles drawn by one job, a sprite row inside a tile fits a column table
+
+// Blends count premultiplied pixels over dst, the i-th taken from row at columns[i]
+typedef void (*soft_span_fn)(uint32_t *dst, const uint32_t *row, const int *columns, int count);
+
+SIMD_DECLARE(soft_span, soft_span_fn);
+
+// CPU copy of a cached texture
+typedef struct {
+	uint32_t *pixels;						// Premultiplied ARGB8888, NULL when the texture has none
+	int w, h;
+} soft_image_t;
+
+// Sprite of the frame placed on the screen
+typedef struct {
+	const soft_image_t *image;
+	SDL_Rect bounds;						// Screen pixels whose centre falls inside the destination
+	SDL_FRect dest;
+	SDL_Rect src;
+	float scale_x, scale_y;					// Source pixels per screen pixel
+	SDL_Color tint;
+	SDL_RendererFlip flip;
+} soft_sprite_t;
+
+// Draws the render queue on the CPU: nearest-neighbour scaled, premultiplied alpha blending, one job per
+// screen tile. Sprites are drawn from CPU copies of their textures, textures without one are skipped.
+typedef struct {
+	texture_cache_t *cache;
+	soft_image_t *images;					// Indexed by texture id
+	int image_count;
+	soft_span_fn span;						// Blender of the CPU, picked at init
+
+	SDL_Texture *frame;						// Streaming texture the frame is drawn into
+	int width, height;
+	uint32_t *target;						// Locked pixels of the frame while drawing
+	int target_pitch;						// In pixels
+
+	soft_sprite_t *sprites;					// In draw order
+	int sprite_count, sprite_capacity;
+	int *bins;								// Sprites of each tile in draw order, one after the other
+	int bin_capacity;
+	int *tile_first;						// Start of each tile in bins, tile_count + 1 entries
+	int tiles_x, tiles_y, tile_capacity;
+	job_t *jobs;
+} soft_render_t;
+
+bool soft_render_init(soft_render_t *soft, texture_cache_t *cache);
+void soft_render_destroy(soft_render_t *soft);
+
+// Copies pixels of a surface into the CPU copy of a texture at (x, y), the copy is made the size of the texture
+bool soft_render_upload(soft_render_t *soft, int texture, int x, int y, const SDL_Surface *surface);
+
+// Draws the sorted queue into a width x height frame on the job threads, NULL on failure
+SDL_Texture *soft_render_draw(soft_render_t *soft, const render_queue_t *queue, job_system_t *jobs, int width, int height);
+
+#endif // SOFT_RENDER_H
@@ -0,0 +1,185 @@
+#include "spatial_grid.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+static int column_of(const spatial_grid_t *grid, float x) {
+	int column = (int)SDL_floorf((x - grid->x) * grid->inverse);
+	return SDL_clamp(column, 0, grid->columns - 1);
+}
+
+static int row_of(const spatial_grid_t *grid, float y) {
+	int row = (int)SDL_floorf((y - grid->y) * grid->inverse);
+	return SDL_clamp(row, 0, grid->rows - 1);
+}
+
+bool spatial_grid_init(spatial_grid_t *grid, float x, float y, float w, float h, float cell_size) {
+	*grid = (spatial_grid_t){
+		.x = x,
+		.y = y,
+		.cell_size = cell_size,
+		.inverse = 1.0f / cell_size,
+		.columns = SDL_max(1, (int)SDL_ceilf(w / cell_size)),
+		.rows = SDL_max(1, (int)SDL_ceilf(h / cell_size)),
+	};
+	int cells = grid->columns * grid->rows;
+	grid->cell_start = calloc(cells + 1, sizeof(int));
+	grid->cursor = malloc(sizeof(int) * cells);
+	if (!grid->cell_start || !grid->cursor) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for a grid of %d cells.\n", cells);
+		return false;
+	}
+	return true;
+}
+
+void spatial_grid_destroy(spatial_grid_t *grid) {
+	free(grid->cell_start);
+	free(grid->cursor);
+	free(grid->items);
+	free(grid->pending);
+	free(grid->keys);
+	free(grid->order);
+	*grid = (spatial_grid_t){0};
+}
+
+static bool resize(void **array, int capacity, size_t item_size) {
+	void *items = realloc(*array, item_size * capacity);
+	if (!items)
+		return false;
+	*array = items;
+	return true;
+}
+
+bool spatial_grid_begin(spatial_grid_t *grid, int count) {
+	if (count > grid->capacity) {
+		int capacity = SDL_max(count, grid->capacity * 2);
+		if (!resize((void **)&grid->items, capacity, sizeof(spatial_item_t)) ||
+			!resize((void **)&grid->pending, capacity, sizeof(spatial_item_t)) ||
+			!resize((void **)&grid->keys, capacity, sizeof(int)) ||
+			!resize((void **)&grid->order, capacity, sizeof(int))) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for %d points in the grid.\n", count);
+			return false;
+		}
+		grid->capacity = capacity;
+	}
+	grid->previous_count = grid->count;
+	grid->count = 0;
+	grid->changed = false;
+	return true;
+}
+
+void spatial_grid_insert(spatial_grid_t *grid, uint32_t id, float x, float y) {
+	int i = grid->count++;
+	int key = row_of(grid, y) * grid->columns + column_of(grid, x);
+	if (i >= grid->previous_count || grid->keys[i] != key || grid->pending[i].id != id)
+		grid->changed = true;
+	grid->keys[i] = key;
+	grid->pending[i] = (spatial_item_t){x, y, id};
+}
+
+void spatial_grid_end(spatial_grid_t *grid) {
+	// Same points in the same cells, the previous order still holds
+	if (!grid->changed && grid->count == grid->previous_count) {
+		for (int i = 0; i < grid->count; ++i)
+			grid->items[grid->order[i]] = grid->pending[i];
+		return;
+	}
+
+	// Counting sort: points per cell, their start, then every point to its slot
+	int cells = grid->columns * grid->rows;
+	memset(grid->cell_start, 0, sizeof(int) * (cells + 1));
+	for (int i = 0; i < grid->count; ++i)
+		grid->cell_start[grid->keys[i] + 1]++;
+	for (int c = 0; c < cells; ++c)
+		grid->cell_start[c + 1] += grid->cell_start[c];
+	memcpy(grid->cursor, grid->cell_start, sizeof(int) * cells);
+	for (int i = 0; i < grid->count; ++i) {
+		int slot = grid->cursor[grid->keys[i]]++;
+		grid->order[i] = slot;
+		grid->items[slot] = grid->pending[i];
+	}
+}
+
+int spatial_grid_query_rect(const spatial_grid_t *grid, float x0, float y0, float x1, float y1, uint32_t *ids, int capacity) {
+	int found = 0;
+	int last_column = column_of(grid, x1), last_row = row_of(grid, y1);
+	for (int row = row_of(grid, y0); row <= last_row; ++row) {
+		// Cells of a row are contiguous, so are their items
+		const int *start = &grid->cell_start[row * grid->columns];
+		for (int i = start[column_of(grid, x0)]; i < start[last_column + 1]; ++i) {
+			const spatial_item_t *item = &grid->items[i];
+			if (item->x >= x0 && item->x <= x1 && item->y >= y0 && item->y <= y1) {
+				if (found < capacity)
+					ids[found] = item->id;
+				found++;
+			}
+		}
+	}
+	return found;
+}
+
+int spatial_grid_query_radius(const spatial_grid_t *grid, float x, float y, float radius, uint32_t *ids, int capacity) {
+	int found = 0;
+	float radius2 = radius * radius;
+	int last_column = column_of(grid, x + radius), last_row = row_of(grid, y + radius);
+	for (int row = row_of(grid, y - radius); row <= last_row; ++row) {
+		const int *start = &grid->cell_start[row * grid->columns];
+		for (int i = start[column_of(grid, x - radius)]; i < start[last_column + 1]; ++i) {
+			float dx = grid->items[i].x - x, dy = grid->items[i].y - y;
+			if (dx * dx + dy * dy <= radius2) {
+				if (found < capacity)
+					ids[found] = grid->items[i].id;
+				found++;
+			}
+		}
+	}
+	return found;
+}
+
+// Keeps the k closest points seen, sorted by distance
+static void keep_nearest(uint32_t *ids, float *distances, int *found, int k, uint32_t id, float distance) {
+	if (*found == k && distance >= distances[k - 1])
+		return;
+	int i = *found < k ? (*found)++ : k - 1;
+	for (; i > 0 && distances[i - 1] > distance; --i) {
+		ids[i] = ids[i - 1];
+		distances[i] = distances[i - 1];
+	}
+	ids[i] = id;
+	distances[i] = distance;
+}
+
+int spatial_grid_nearest(const spatial_grid_t *grid, float x, float y, int k, uint32_t *ids) {
+	float distances[SPATIAL_GRID_MAX_NEAREST];
+	k = SDL_min(k, SPATIAL_GRID_MAX_NEAREST);
+	int found = 0;
+	if (k <= 0)
+		return 0;
+
+	// Rings of cells around the point, a point of ring r + 1 is at least r cells away
+	int column = column_of(grid, x), row = row_of(grid, y);
+	int rings = SDL_max(grid->columns, grid->rows);
+	for (int r = 0; r < rings; ++r) {
+		for (int cy = row - r; cy <= row + r; ++cy) {
+			if (cy < 0 || cy >= grid->rows)
+				continue;
+			// Whole rows at the top and bottom of the ring, the two side cells otherwise
+			int step = (cy == row - r || cy == row + r) ? 1 : SDL_max(2 * r, 1);
+			for (int cx = column - r; cx <= column + r; cx += step) {
+				if (cx < 0 || cx >= grid->columns)
+					continue;
+				int cell = cy * grid->columns + cx;
+				for (int i = grid->cell_start[cell]; i < grid->cell_start[cell + 1]; ++i) {
+					float dx = grid->items[i].x - x, dy = grid->items[i].y - y;
+					keep_nearest(ids, distances, &found, k, grid->items[i].id, dx * dx + dy * dy);
+				}
+			}
+		}
+		float reach = r * grid->cell_size;
+		if (found == k && distances[k - 1] <= reach * reach)
+			break;
+	}
+	return found;
+}
@@ -0,0 +1,48 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SPATIAL_GRID_MAX_NEAREST 64
+
+typedef struct {
+	float x, y;
+	uint32_t id;
+} spatial_item_t;
+
+// Uniform grid of points over a rectangle, points outside it are kept in the border cells.
+// Items are counting-sorted by cell, so the items of a cell are contiguous.
+typedef struct {
+	float x, y;							// Top-left corner of the covered rectangle
+	float cell_size, inverse;
+	int columns, rows;
+	int *cell_start;					// Items of cell c are [cell_start[c], cell_start[c + 1])
+	spatial_item_t *items;				// Sorted by cell
+
+	// Points of the build in progress, in insertion order
+	spatial_item_t *pending;
+	int *keys;							// Cell of each point
+	int *order;							// Index of each point in items
+	int *cursor;						// Next free item of each cell while scattering
+	int count, previous_count, capacity;
+	bool changed;						// Some point is not in the cell it had at the same index last build
+} spatial_grid_t;
+
+bool spatial_grid_init(spatial_grid_t *grid, float x, float y, float w, float h, float cell_size);
+void spatial_grid_destroy(spatial_grid_t *grid);
+
+// Rebuild: begin with the number of points, insert each of them, end.
+// When every point is inserted at the same index and stays in its cell, end only copies positions.
+bool spatial_grid_begin(spatial_grid_t *grid, int count);
+void spatial_grid_insert(spatial_grid_t *grid, uint32_t id, float x, float y);
+void spatial_grid_end(spatial_grid_t *grid);
+
+// Ids of the points inside a rectangle/circle, writes at most capacity of them and returns how many there are
+int spatial_grid_query_rect(const spatial_grid_t *grid, float x0, float y0, float x1, float y1, uint32_t *ids, int capacity);
+int spatial_grid_query_radius(const spatial_grid_t *grid, float x, float y, float radius, uint32_t *ids, int capacity);
+
+// Up to k (at most SPATIAL_GRID_MAX_NEAREST) closest points, nearest first, returns how many were found
+int spatial_grid_nearest(const spatial_grid_t *grid, float x, float y, int k, uint32_t *ids);
+
+#endif // SPATIAL_GRID_H
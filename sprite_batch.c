@@ -0,0 +1,137 @@
+#include "sprite_batch.h"
+
+#include <stdlib.h>
+
+#define QUAD_VERTICES 4
+#define QUAD_INDICES 6
+
+static bool resize(void **array, int capacity, size_t item_size) {
+	void *items = realloc(*array, item_size * capacity);
+	if (!items)
+		return false;
+	*array = items;
+	return true;
+}
+
+bool sprite_batch_init(sprite_batch_t *batch, SDL_Renderer *renderer) {
+	*batch = (sprite_batch_t){.renderer = renderer, .last_texture = -1};
+	return true;
+}
+
+void sprite_batch_destroy(sprite_batch_t *batch) {
+	free(batch->vertices);
+	free(batch->quad_textures);
+	free(batch->indices);
+	free(batch->textures);
+	*batch = (sprite_batch_t){0};
+}
+
+static bool grow_quads(sprite_batch_t *batch) {
+	int capacity = batch->quad_capacity ? batch->quad_capacity * 2 : 1024;
+	if (!resize((void **)&batch->vertices, capacity, sizeof(SDL_Vertex) * QUAD_VERTICES) ||
+		!resize((void **)&batch->quad_textures, capacity, sizeof(int)) ||
+		!resize((void **)&batch->indices, capacity, sizeof(int) * QUAD_INDICES))
+		return false;
+	batch->quad_capacity = capacity;
+	return true;
+}
+
+// Index of a texture in the batch, added on first use
+static int find_texture(sprite_batch_t *batch, SDL_Texture *texture) {
+	if (batch->last_texture >= 0 && batch->textures[batch->last_texture].texture == texture)
+		return batch->last_texture;
+	for (int i = 0; i < batch->texture_count; ++i)
+		if (batch->textures[i].texture == texture)
+			return batch->last_texture = i;
+
+	int w, h;
+	if (SDL_QueryTexture(texture, NULL, NULL, &w, &h) != 0)
+		return -1;
+	if (batch->texture_count == batch->texture_capacity) {
+		int capacity = batch->texture_capacity ? batch->texture_capacity * 2 : 8;
+		if (!resize((void **)&batch->textures, capacity, sizeof(sprite_batch_texture_t)))
+			return -1;
+		batch->texture_capacity = capacity;
+	}
+	batch->textures[batch->texture_count] = (sprite_batch_texture_t){texture, 1.0f / w, 1.0f / h, 0, 0};
+	return batch->last_texture = batch->texture_count++;
+}
+
+bool sprite_batch_add(sprite_batch_t *batch, SDL_Texture *texture, const SDL_Rect *src, const SDL_FRect *dest,
+					  SDL_Color tint, SDL_RendererFlip flip) {
+	if (batch->quad_count == batch->quad_capacity && !grow_quads(batch))
+		return false;
+	int id = find_texture(batch, texture);
+	if (id < 0)
+		return false;
+	sprite_batch_texture_t *entry = &batch->textures[id];
+
+	float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+	if (src) {
+		u0 = src->x * entry->inv_w;
+		v0 = src->y * entry->inv_h;
+		u1 = (src->x + src->w) * entry->inv_w;
+		v1 = (src->y + src->h) * entry->inv_h;
+	}
+	// Flips swap the texture coordinates, the corners stay where they are
+	if (flip & SDL_FLIP_HORIZONTAL) {
+		float u = u0;
+		u0 = u1;
+		u1 = u;
+	}
+	if (flip & SDL_FLIP_VERTICAL) {
+		float v = v0;
+		v0 = v1;
+		v1 = v;
+	}
+
+	// Top left, top right, bottom right, bottom left
+	const float x0 = dest->x, y0 = dest->y, x1 = dest->x + dest->w, y1 = dest->y + dest->h;
+	SDL_Vertex *vertex = &batch->vertices[batch->quad_count * QUAD_VERTICES];
+	vertex[0] = (SDL_Vertex){{x0, y0}, tint, {u0, v0}};
+	vertex[1] = (SDL_Vertex){{x1, y0}, tint, {u1, v0}};
+	vertex[2] = (SDL_Vertex){{x1, y1}, tint, {u1, v1}};
+	vertex[3] = (SDL_Vertex){{x0, y1}, tint, {u0, v1}};
+
+	batch->quad_textures[batch->quad_count++] = id;
+	++entry->quad_count;
+	return true;
+}
+
+void sprite_batch_flush(sprite_batch_t *batch) {
+	batch->draw_calls = 0;
+
+	// Counting sort of the quads by texture, the vertices stay where they are and only indices move
+	int first = 0;
+	for (int i = 0; i < batch->texture_count; ++i) {
+		batch->textures[i].first_index = first;
+		first += batch->textures[i].quad_count * QUAD_INDICES;
+	}
+	for (int quad = 0; quad < batch->quad_count; ++quad) {
+		sprite_batch_texture_t *entry = &batch->textures[batch->quad_textures[quad]];
+		int *index = &batch->indices[entry->first_index];
+		const int base = quad * QUAD_VERTICES;
+		index[0] = base;
+		index[1] = base + 1;
+		index[2] = base + 2;
+		index[3] = base;
+		index[4] = base + 2;
+		index[5] = base + 3;
+		entry->first_index += QUAD_INDICES;
+	}
+
+	// Each texture ends where the next one starts
+	for (int i = 0; i < batch->texture_count; ++i) {
+		const sprite_batch_texture_t *entry = &batch->textures[i];
+		const int index_count = entry->quad_count * QUAD_INDICES;
+		if (SDL_RenderGeometry(batch->renderer, entry->texture, batch->vertices, batch->quad_count * QUAD_VERTICES,
+							   batch->indices + entry->first_index - index_count, index_count) != 0)
+			SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Could not draw sprites: %s\n", SDL_GetError());
+		++batch->draw_calls;
+	}
+
+	// Textures are looked up again next frame, one of them may have been freed or replaced
+	batch->quad_count = 0;
+	batch->texture_count = 0;
+	batch->last_texture = -1;
+}
@@ -0,0 +1,39 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+// Texture of a batch and the quads drawn with it
+typedef struct {
+	SDL_Texture *texture;
+	float inv_w, inv_h;					// Texels to texture coordinates
+	int quad_count;
+	int first_index;					// Start of its quads in the index buffer, set by the flush
+} sprite_batch_texture_t;
+
+// Sprites of a frame in one vertex buffer, drawn with one SDL_RenderGeometry call per texture.
+// Sprites of the same texture keep their order, textures are drawn in the order they were first added.
+typedef struct {
+	SDL_Renderer *renderer;
+	SDL_Vertex *vertices;				// Four per sprite, in the order they were added
+	int *quad_textures;					// Texture of each sprite, index in textures
+	int quad_count, quad_capacity;
+	int *indices;						// Six per sprite, grouped by texture at flush
+	sprite_batch_texture_t *textures;
+	int texture_count, texture_capacity;
+	int last_texture;					// Texture of the last sprite, most sprites share it with the one before
+	int draw_calls;						// Geometry calls of the last flush
+} sprite_batch_t;
+
+bool sprite_batch_init(sprite_batch_t *batch, SDL_Renderer *renderer);
+void sprite_batch_destroy(sprite_batch_t *batch);
+
+// Queues a sprite, src is the rect inside the texture (NULL for all of it). False when out of memory.
+bool sprite_batch_add(sprite_batch_t *batch, SDL_Texture *texture, const SDL_Rect *src, const SDL_FRect *dest,
+					  SDL_Color tint, SDL_RendererFlip flip);
+// Draws every queued sprite and empties the batch
+void sprite_batch_flush(sprite_batch_t *batch);
+
+#endif // SPRITE_BATCH_H
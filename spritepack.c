@@ -0,0 +1,159 @@
+#include "spritepack.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Sets missing when there is no file at path
+static bool map_file(spk_pack_t *pack, const char *path, bool *missing) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		DWORD error = GetLastError();
+		*missing = error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	const void *data = NULL;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+		data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	pack->data = data;
+	pack->size = (size_t)size.QuadPart;
+	pack->file = file;
+	pack->mapping = mapping;
+	return true;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		*missing = errno == ENOENT;
+		return false;
+	}
+
+	struct stat st;
+	void *data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// Mapping stays valid once the descriptor is closed
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	pack->data = data;
+	pack->size = (size_t)st.st_size;
+	return true;
+#endif
+}
+
+static void unmap_file(spk_pack_t *pack) {
+#ifdef _WIN32
+	UnmapViewOfFile(pack->data);
+	CloseHandle(pack->mapping);
+	CloseHandle(pack->file);
+#else
+	munmap((void *)pack->data, pack->size);
+#endif
+}
+
+static bool validate(const spk_pack_t *pack) {
+	const spk_header_t *header = (const spk_header_t *)pack->data;
+	if (pack->size < sizeof(spk_header_t) || header->magic != SPK_MAGIC || header->version != SPK_VERSION)
+		return false;
+
+	uint64_t sheets_end = header->sheet_offset + (uint64_t)header->sheet_count * sizeof(spk_sheet_t);
+	uint64_t frames_end = header->frame_offset + (uint64_t)header->frame_count * sizeof(spk_frame_t);
+	uint64_t pixels_end = header->pixel_offset + (uint64_t)header->pitch * header->height;
+	if (sheets_end > pack->size || frames_end > pack->size || pixels_end > pack->size)
+		return false;
+	if (header->pitch < header->width * SDL_BYTESPERPIXEL(header->pixel_format))
+		return false;
+
+	const spk_sheet_t *sheets = (const spk_sheet_t *)(pack->data + header->sheet_offset);
+	for (uint32_t i = 0; i < header->sheet_count; ++i) {
+		if (!sheets[i].frame_w || !sheets[i].frame_h || sheets[i].frame_w > sheets[i].w)
+			return false;
+		if ((uint64_t)sheets[i].first_frame + sheets[i].frame_count > header->frame_count)
+			return false;
+	}
+
+	const spk_frame_t *frames = (const spk_frame_t *)(pack->data + header->frame_offset);
+	for (uint32_t i = 0; i < header->frame_count; ++i)
+		if ((uint32_t)frames[i].x + frames[i].w > header->width || (uint32_t)frames[i].y + frames[i].h > header->height)
+			return false;
+	return true;
+}
+
+bool spk_open(spk_pack_t *pack, const char *path) {
+	*pack = (spk_pack_t){0};
+	bool missing = false;
+	if (!map_file(pack, path, &missing)) {
+		// The pack is optional, sheets are decoded from their images without it
+		if (missing)
+			SDL_Log("No sprite pack at %s\n", path);
+		else
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not map sprite pack %s\n", path);
+		return false;
+	}
+	if (!validate(pack)) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Sprite pack %s is corrupted or from another version\n", path);
+		spk_close(pack);
+		return false;
+	}
+
+	pack->header = (const spk_header_t *)pack->data;
+	pack->sheets = (const spk_sheet_t *)(pack->data + pack->header->sheet_offset);
+	pack->frames = (const spk_frame_t *)(pack->data + pack->header->frame_offset);
+	pack->pixels = pack->data + pack->header->pixel_offset;
+	SDL_Log("Mapped sprite pack %s (%u sheets, %zu bytes)\n", path, pack->header->sheet_count, pack->size);
+	return true;
+}
+
+void spk_close(spk_pack_t *pack) {
+	if (pack->data)
+		unmap_file(pack);
+	*pack = (spk_pack_t){0};
+}
+
+SDL_Texture *spk_upload(const spk_pack_t *pack, SDL_Renderer *renderer) {
+	const spk_header_t *header = pack->header;
+
+	// Pixels in a format the renderer does not support get converted by SDL on upload
+	SDL_RendererInfo info = {.name = "renderer"};
+	bool native = false;
+	if (SDL_GetRendererInfo(renderer, &info) == 0)
+		for (uint32_t i = 0; i < info.num_texture_formats; ++i)
+			native |= info.texture_formats[i] == header->pixel_format;
+	if (!native)
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Sprite pack uses %s which %s converts on upload, repack it with -f\n",
+					SDL_GetPixelFormatName(header->pixel_format), info.name);
+
+	SDL_Texture *texture = SDL_CreateTexture(renderer, header->pixel_format, SDL_TEXTUREACCESS_STATIC, (int)header->width, (int)header->height);
+	if (!texture) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create sprite pack texture: %s\n", SDL_GetError());
+		return NULL;
+	}
+	if (SDL_UpdateTexture(texture, NULL, pack->pixels, (int)header->pitch) != 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not upload sprite pack: %s\n", SDL_GetError());
+		SDL_DestroyTexture(texture);
+		return NULL;
+	}
+	if (SDL_ISPIXELFORMAT_ALPHA(header->pixel_format))
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	return texture;
+}
@@ -0,0 +1,66 @@
+#ifndef SPRITEPACK_H
+#define SPRITEPACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <SDL.h>
+
+// Sprite pack (.spk): pre-decoded frames, trimmed to their visible pixels and packed
+// into one image ready to be uploaded as it is.
+// Layout, little-endian:
+//   spk_header_t
+//   spk_sheet_t[sheet_count]	at sheet_offset
+//   spk_frame_t[frame_count]	at frame_offset
+//   pixels						at pixel_offset, height rows of pitch bytes in pixel_format
+#define SPK_MAGIC 0x314B5053u			// "SPK1"
+#define SPK_VERSION 2
+#define SPK_NAME_SIZE 32
+#define SPK_ALIGN 64					// Alignment of every table and of the pixels
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t pixel_format;				// SDL_PIXELFORMAT_* of the pixels
+	uint32_t width, height, pitch;		// Size of the whole pixel block
+	uint32_t sheet_count;
+	uint32_t frame_count;
+	uint32_t sheet_offset;
+	uint32_t frame_offset;
+	uint32_t pixel_offset;
+	uint32_t reserved[5];
+} spk_header_t;
+
+typedef struct {
+	char name[SPK_NAME_SIZE];			// Base name of the source image, without extension
+	uint32_t w, h;						// Untrimmed size of the source image
+	uint32_t frame_w, frame_h;			// Untrimmed size of one frame of its grid
+	uint32_t first_frame;				// Index of the first frame of the sheet in the frame table
+	uint32_t frame_count;				// Frames of the grid, row by row
+} spk_sheet_t;
+
+typedef struct {
+	uint16_t x, y, w, h;				// Trimmed region inside the pixel block, empty for a transparent frame
+	int16_t offset_x, offset_y;			// Position of the trimmed region inside the untrimmed frame
+} spk_frame_t;
+
+// Read-only mapping of a pack file
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+	const spk_header_t *header;
+	const spk_sheet_t *sheets;
+	const spk_frame_t *frames;
+	const void *pixels;
+	void *file, *mapping;				// Platform handles of the mapping
+} spk_pack_t;
+
+// False when the pack is missing, unreadable or corrupted, only a missing pack is not logged as an error
+bool spk_open(spk_pack_t *pack, const char *path);
+void spk_close(spk_pack_t *pack);
+
+// Creates a texture and uploads the pixels straight from the mapping
+SDL_Texture *spk_upload(const spk_pack_t *pack, SDL_Renderer *renderer);
+
+#endif // SPRITEPACK_H
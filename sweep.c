@@ -0,0 +1,189 @@
+#include "sweep.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#define SHIFTS_PER_BOX 8				// Insertion sort gives up for qsort past this many shifts per box
+
+static bool resize(void **array, int capacity, size_t item_size) {
+	void *items = realloc(*array, item_size * capacity);
+	if (!items)
+		return false;
+	*array = items;
+	return true;
+}
+
+static bool add_pair(sweep_t *sweep, int a, int b) {
+	if (sweep->pair_count == sweep->pair_capacity) {
+		int capacity = sweep->pair_capacity ? sweep->pair_capacity * 2 : 1024;
+		if (!resize((void **)&sweep->pairs, capacity, sizeof(sweep_pair_t)))
+			return false;
+		sweep->pair_capacity = capacity;
+	}
+	sweep->pairs[sweep->pair_count++] = (sweep_pair_t){sweep->sorted_ids[a], sweep->sorted_ids[b]};
+	return true;
+}
+
+// Boxes after i overlap it on x until the first one starting past its end
+static bool sweep_scalar(sweep_t *sweep) {
+	const float *min_x = sweep->min_x, *max_x = sweep->max_x, *min_y = sweep->min_y, *max_y = sweep->max_y;
+	for (int i = 0; i < sweep->count; ++i)
+		for (int j = i + 1; j < sweep->count && min_x[j] <= max_x[i]; ++j)
+			if (min_y[j] <= max_y[i] && max_y[j] >= min_y[i] && !add_pair(sweep, i, j))
+				return false;
+	return true;
+}
+
+// Lanes hit on x form a prefix since boxes are sorted, so the first block with a miss is the last one
+
+#ifdef SIMD_SSE2
+static bool sweep_sse2(sweep_t *sweep) {
+	const float *min_x = sweep->min_x, *max_x = sweep->max_x, *min_y = sweep->min_y, *max_y = sweep->max_y;
+	const int n = sweep->count;
+	for (int i = 0; i < n; ++i) {
+		const __m128 end_x = _mm_set1_ps(max_x[i]), start_y = _mm_set1_ps(min_y[i]), end_y = _mm_set1_ps(max_y[i]);
+		int j = i + 1, in_x = 0xF;
+		for (; j + 4 <= n && in_x == 0xF; j += 4) {
+			in_x = _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(min_x + j), end_x));
+			__m128 in_y = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(min_y + j), end_y), _mm_cmpge_ps(_mm_loadu_ps(max_y + j), start_y));
+			for (int hit = in_x & _mm_movemask_ps(in_y); hit; hit &= hit - 1)
+				if (!add_pair(sweep, i, j + __builtin_ctz(hit)))
+					return false;
+		}
+		for (; in_x == 0xF && j < n && min_x[j] <= max_x[i]; ++j)
+			if (min_y[j] <= max_y[i] && max_y[j] >= min_y[i] && !add_pair(sweep, i, j))
+				return false;
+	}
+	return true;
+}
+#endif
+
+#ifdef SIMD_AVX2
+SIMD_TARGET_AVX2
+static bool sweep_avx2(sweep_t *sweep) {
+	const float *min_x = sweep->min_x, *max_x = sweep->max_x, *min_y = sweep->min_y, *max_y = sweep->max_y;
+	const int n = sweep->count;
+	for (int i = 0; i < n; ++i) {
+		const __m256 end_x = _mm256_set1_ps(max_x[i]), start_y = _mm256_set1_ps(min_y[i]), end_y = _mm256_set1_ps(max_y[i]);
+		int j = i + 1, in_x = 0xFF;
+		for (; j + 8 <= n && in_x == 0xFF; j += 8) {
+			in_x = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(min_x + j), end_x, _CMP_LE_OQ));
+			__m256 in_y = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(min_y + j), end_y, _CMP_LE_OQ),
+										_mm256_cmp_ps(_mm256_loadu_ps(max_y + j), start_y, _CMP_GE_OQ));
+			for (int hit = in_x & _mm256_movemask_ps(in_y); hit; hit &= hit - 1)
+				if (!add_pair(sweep, i, j + __builtin_ctz(hit)))
+					return false;
+		}
+		for (; in_x == 0xFF && j < n && min_x[j] <= max_x[i]; ++j)
+			if (min_y[j] <= max_y[i] && max_y[j] >= min_y[i] && !add_pair(sweep, i, j))
+				return false;
+	}
+	return true;
+}
+#endif
+
+SIMD_DEFINE(sweep, sweep_fn, sweep_scalar, sweep_sse2, sweep_avx2)
+
+bool sweep_init(sweep_t *sweep) {
+	*sweep = (sweep_t){.run = sweep_select()};
+	return true;
+}
+
+void sweep_destroy(sweep_t *sweep) {
+	free(sweep->ids);
+	free(sweep->boxes);
+	free(sweep->entries);
+	free(sweep->min_x);
+	free(sweep->max_x);
+	free(sweep->min_y);
+	free(sweep->max_y);
+	free(sweep->sorted_ids);
+	free(sweep->pairs);
+	*sweep = (sweep_t){0};
+}
+
+bool sweep_begin(sweep_t *sweep, int count) {
+	if (count > sweep->capacity) {
+		int capacity = SDL_max(count, sweep->capacity * 2);
+		bool ok = resize((void **)&sweep->ids, capacity, sizeof(uint32_t)) &&
+				  resize((void **)&sweep->boxes, capacity, sizeof(float[4])) &&
+				  resize((void **)&sweep->entries, capacity, sizeof(sweep_entry_t)) &&
+				  resize((void **)&sweep->min_x, capacity, sizeof(float)) &&
+				  resize((void **)&sweep->max_x, capacity, sizeof(float)) &&
+				  resize((void **)&sweep->min_y, capacity, sizeof(float)) &&
+				  resize((void **)&sweep->max_y, capacity, sizeof(float)) &&
+				  resize((void **)&sweep->sorted_ids, capacity, sizeof(uint32_t));
+		if (!ok) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to sweep %d boxes.\n", count);
+			return false;
+		}
+		sweep->capacity = capacity;
+	}
+	sweep->previous_count = sweep->count;
+	sweep->count = 0;
+	return true;
+}
+
+void sweep_insert(sweep_t *sweep, uint32_t id, float min_x, float min_y, float max_x, float max_y) {
+	int i = sweep->count++;
+	sweep->ids[i] = id;
+	sweep->boxes[i][0] = min_x;
+	sweep->boxes[i][1] = min_y;
+	sweep->boxes[i][2] = max_x;
+	sweep->boxes[i][3] = max_y;
+}
+
+static int compare_entries(const void *a, const void *b) {
+	float x = ((const sweep_entry_t *)a)->min_x, y = ((const sweep_entry_t *)b)->min_x;
+	return (x > y) - (x < y);
+}
+
+// Insertion sort from the last order, false when boxes moved too much for it to pay off
+static bool insertion_sort(sweep_entry_t *entries, int count) {
+	long budget = (long)count * SHIFTS_PER_BOX;
+	for (int i = 1; i < count; ++i) {
+		sweep_entry_t entry = entries[i];
+		int j = i;
+		for (; j > 0 && entries[j - 1].min_x > entry.min_x; --j)
+			entries[j] = entries[j - 1];
+		entries[j] = entry;
+		budget -= i - j;
+		if (budget < 0)
+			return false;
+	}
+	return true;
+}
+
+bool sweep_end(sweep_t *sweep) {
+	const int n = sweep->count;
+	sweep_entry_t *entries = sweep->entries;
+	if (n == sweep->previous_count) {
+		for (int k = 0; k < n; ++k)
+			entries[k].min_x = sweep->boxes[entries[k].index][0];
+		if (!insertion_sort(entries, n))
+			qsort(entries, n, sizeof(sweep_entry_t), compare_entries);
+	} else {
+		// Boxes came or went, indexes of the last order mean nothing anymore
+		for (int k = 0; k < n; ++k)
+			entries[k] = (sweep_entry_t){sweep->boxes[k][0], k};
+		qsort(entries, n, sizeof(sweep_entry_t), compare_entries);
+	}
+
+	for (int k = 0; k < n; ++k) {
+		const float *box = sweep->boxes[entries[k].index];
+		sweep->min_x[k] = box[0];
+		sweep->min_y[k] = box[1];
+		sweep->max_x[k] = box[2];
+		sweep->max_y[k] = box[3];
+		sweep->sorted_ids[k] = sweep->ids[entries[k].index];
+	}
+
+	sweep->pair_count = 0;
+	if (!sweep->run(sweep)) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory for more than %d overlapping boxes.\n", sweep->pair_count);
+		return false;
+	}
+	return true;
+}
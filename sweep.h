@@ -0,0 +1,54 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "simd.h"
+
+// Two boxes that overlap, a has the smaller min x
+typedef struct {
+	uint32_t a, b;
+} sweep_pair_t;
+
+// Box at its place in the x order, index is its insertion index
+typedef struct {
+	float min_x;
+	int index;
+} sweep_entry_t;
+
+struct sweep;
+typedef bool (*sweep_fn)(struct sweep *sweep);		// False when the pair list cannot grow
+
+// Sort-and-sweep broad phase along x. The x order of the last run is the starting point of the next,
+// so boxes that barely moved are sorted again in close to linear time.
+typedef struct sweep {
+	// Boxes in insertion order
+	uint32_t *ids;
+	float (*boxes)[4];					// min x, min y, max x, max y
+	int count, previous_count, capacity;
+
+	// Boxes in x order, as separate arrays so several are tested at once
+	sweep_entry_t *entries;
+	float *min_x, *max_x, *min_y, *max_y;
+	uint32_t *sorted_ids;
+
+	sweep_pair_t *pairs;				// Overlapping boxes of the last run
+	int pair_count, pair_capacity;
+	sweep_fn run;						// Sweep of the CPU, picked at init
+} sweep_t;
+
+bool sweep_init(sweep_t *sweep);
+void sweep_destroy(sweep_t *sweep);
+
+// Every variant finds the same pairs in the same order
+SIMD_DECLARE(sweep, sweep_fn);
+
+// Run: begin with the number of boxes, insert each of them, end.
+// Boxes should be inserted in the same order every time for the previous x order to help.
+bool sweep_begin(sweep_t *sweep, int count);
+void sweep_insert(sweep_t *sweep, uint32_t id, float min_x, float min_y, float max_x, float max_y);
+// Sorts and fills pairs, false when the pair list cannot grow (pairs found so far are kept)
+bool sweep_end(sweep_t *sweep);
+
+#endif // SWEEP_H
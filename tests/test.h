@@ -0,0 +1,49 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <string.h>
+
+// Checks of one test program, every failed one is printed and main returns test_result
+static int test_checks, test_failures;
+
+#define CHECK(condition) \
+	do { \
+		++test_checks; \
+		if (!(condition)) { \
+			++test_failures; \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+		} \
+	} while (0)
+
+static inline int test_result(const char *name) {
+	printf("%s: %d checks, %d failed\n", name, test_checks, test_failures);
+	return test_failures ? 1 : 0;
+}
+
+// Declares the kernels of a SIMD_DEFINE dispatch (simd.h) as variants and their number as count, checks
+// its contract: the scalar kernel first, select picking the last, each one built and named once.
+// A test then runs variants[0] and each of variants[1..count) on the same input and compares.
+#define TEST_VARIANTS(prefix, type, variants, count) \
+	type variants[SIMD_VARIANTS]; \
+	const int count = prefix##_variants(variants); \
+	CHECK(strcmp(prefix##_name(variants[0]), "scalar") == 0); \
+	CHECK(prefix##_select() == variants[count - 1]); \
+	for (int test_variant = 1; test_variant < count; ++test_variant) \
+		CHECK(strcmp(prefix##_name(variants[test_variant]), "unknown") != 0 && \
+			  strcmp(prefix##_name(variants[test_variant]), prefix##_name(variants[test_variant - 1])) != 0)
+
+// Deterministic random numbers, a failure happens again on every run
+static unsigned test_seed = 12345;
+
+static inline unsigned test_rand(void) {
+	test_seed = test_seed * 1103515245u + 12345u;
+	return test_seed >> 8;
+}
+
+// Uniform in [low, high)
+static inline float test_randf(float low, float high) {
+	return low + (high - low) * (float)(test_rand() & 0xFFFFFF) / (float)0x1000000;
+}
+
+#endif // TEST_H
@@ -0,0 +1,62 @@
+#include <string.h>
+
+#include "camera.h"
+#include "test.h"
+
+#define MAX_BOXES 67
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	TEST_VARIANTS(camera_cull, camera_cull_fn, variants, variant_count);
+	CHECK(variants[0] == camera_cull_scalar);
+
+	// Every count up to a few vectors, so the SSE2 and AVX2 loops end on each tail length
+	for (int count = 0; count <= MAX_BOXES; ++count) {
+		for (int round = 0; round < 20; ++round) {
+			float position[MAX_BOXES * 2], extent[MAX_BOXES * 2];
+			for (int i = 0; i < count; ++i) {
+				position[i * 2] = test_randf(-200, 1200);
+				position[i * 2 + 1] = test_randf(-200, 900);
+				extent[i * 2] = test_randf(0, 150);
+				extent[i * 2 + 1] = test_randf(0, 150);
+			}
+			// Some boxes exactly touching the view, which counts as visible
+			const float view[4] = {0, 0, 1000, 700};
+			if (count > 0) {
+				position[0] = view[2];
+				position[(count - 1) * 2 + 1] = view[1] - extent[(count - 1) * 2 + 1];
+			}
+
+			int expected[MAX_BOXES], expected_count = 0;
+			for (int i = 0; i < count; ++i)
+				if (position[i * 2] <= view[2] && position[i * 2 + 1] <= view[3] &&
+					position[i * 2] + extent[i * 2] >= view[0] && position[i * 2 + 1] + extent[i * 2 + 1] >= view[1])
+					expected[expected_count++] = i;
+
+			for (int v = 0; v < variant_count; ++v) {
+				int visible[MAX_BOXES];
+				int n = variants[v](position, extent, count, view, visible);
+				CHECK(n == expected_count && memcmp(visible, expected, sizeof(int) * (size_t)n) == 0);
+			}
+		}
+	}
+
+	// The view follows the zoom and stays inside the world
+	camera_t camera;
+	camera_init(&camera, 4000, 3000, 1000, 500);
+	camera_set_zoom(&camera, 2);
+	camera_follow(&camera, 10, 10);
+	SDL_FRect view = camera_view(&camera);
+	CHECK(view.x == 0 && view.y == 0 && view.w == 500 && view.h == 250);
+	camera_follow(&camera, 3990, 2990);
+	view = camera_view(&camera);
+	CHECK(view.x + view.w == 4000 && view.y + view.h == 3000);
+	camera_set_zoom(&camera, 100);
+	CHECK(camera.zoom == CAMERA_MAX_ZOOM);
+	camera_set_zoom(&camera, 0);
+	CHECK(camera.zoom == CAMERA_MIN_ZOOM);
+
+	return test_result("camera");
+}
@@ -0,0 +1,99 @@
+#include "collision_mask.h"
+#include "test.h"
+
+// Opaque screen pixel of a frame drawn at (x, y), read bit by bit
+static bool opaque(const collision_mask_t *mask, int frame, int x, int y, int px, int py) {
+	int column = px - x, row = (py - y) / mask->scale;
+	if (px < x || py < y || column >= mask->frame_w * mask->scale || row >= mask->frame_h)
+		return false;
+	const uint64_t *bits = mask->bits + ((size_t)frame * mask->frame_h + row) * mask->words;
+	return bits[column / 64] >> (column % 64) & 1;
+}
+
+static bool brute_overlap(const collision_mask_t *a, int frame_a, int ax, int ay,
+						  const collision_mask_t *b, int frame_b, int bx, int by) {
+	for (int py = SDL_min(ay, by); py < SDL_max(ay + a->frame_h * a->scale, by + b->frame_h * b->scale); ++py)
+		for (int px = SDL_min(ax, bx); px < SDL_max(ax + a->frame_w * a->scale, bx + b->frame_w * b->scale); ++px)
+			if (opaque(a, frame_a, ax, ay, px, py) && opaque(b, frame_b, bx, by, px, py))
+				return true;
+	return false;
+}
+
+// A few opaque blobs per frame, set the way the readers set them: scale bits per sheet pixel
+static void fill(collision_mask_t *mask, int blobs) {
+	int frames = mask->columns * mask->rows;
+	for (int frame = 0; frame < frames; ++frame) {
+		for (int blob = 0; blob < blobs; ++blob) {
+			int x0 = (int)(test_rand() % (unsigned)mask->frame_w), y0 = (int)(test_rand() % (unsigned)mask->frame_h);
+			int w = 1 + (int)(test_rand() % 6), h = 1 + (int)(test_rand() % 6);
+			for (int y = y0; y < SDL_min(y0 + h, mask->frame_h); ++y)
+				for (int x = x0; x < SDL_min(x0 + w, mask->frame_w); ++x)
+					for (int bit = x * mask->scale; bit < (x + 1) * mask->scale; ++bit)
+						mask->bits[((size_t)frame * mask->frame_h + y) * mask->words + bit / 64] |= (uint64_t)1 << (bit % 64);
+		}
+	}
+	mask->ready = true;
+}
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	// Masks one, two and three words wide, the widest ones start words at every offset of the others
+	static anim_table_t small = {.frame_w = 20, .frame_h = 12, .columns = 2, .rows = 2};
+	static anim_table_t wide = {.frame_w = 50, .frame_h = 10, .columns = 3, .rows = 1};
+	collision_mask_t a, b, c;
+	CHECK(collision_mask_init(&a, &small, 2));
+	CHECK(collision_mask_init(&b, &wide, 3));
+	CHECK(collision_mask_init(&c, &wide, 2));
+	CHECK(a.words == 1 && b.words == 3 && c.words == 2);
+
+	// Sheets still loading collide as full rects
+	CHECK(collision_mask_overlap(&a, 0, 0, 0, &b, 0, 39, 23));
+	CHECK(!collision_mask_overlap(&a, 0, 0, 0, &b, 0, 40, 0));
+	CHECK(!collision_mask_overlap(&a, 0, 0, 0, &b, 0, -150, 0));
+	CHECK(collision_mask_overlap(&a, 0, 0, 0, &b, 0, -149, -29));
+
+	fill(&a, 3);
+	fill(&b, 4);
+	fill(&c, 4);
+
+	// Every relative position where the rects overlap, negative offsets included, against a pixel by pixel test
+	const collision_mask_t *masks[3] = {&a, &b, &c};
+	int mismatches = 0, hits = 0, tests = 0;
+	for (int first = 0; first < 3; ++first) {
+		for (int second = 0; second < 3; ++second) {
+			const collision_mask_t *m = masks[first], *n = masks[second];
+			int frame_m = (int)(test_rand() % (unsigned)(m->columns * m->rows));
+			int frame_n = (int)(test_rand() % (unsigned)(n->columns * n->rows));
+			int ax = (int)(test_rand() % 100) - 50, ay = (int)(test_rand() % 20) - 10;
+			for (int dy = -n->frame_h * n->scale; dy <= m->frame_h * m->scale; dy += 3) {
+				for (int dx = -n->frame_w * n->scale - 1; dx <= m->frame_w * m->scale + 1; ++dx) {
+					bool expected = brute_overlap(m, frame_m, ax, ay, n, frame_n, ax + dx, ay + dy);
+					bool found = collision_mask_overlap(m, frame_m, ax, ay, n, frame_n, ax + dx, ay + dy);
+					mismatches += expected != found;
+					hits += expected;
+					++tests;
+				}
+			}
+		}
+	}
+	CHECK(mismatches == 0);
+	CHECK(hits > 0 && hits < tests);
+
+	// Overlap does not depend on which mask comes first
+	bool symmetric = true;
+	for (int dx = -160; dx <= 160; ++dx)
+		symmetric &= collision_mask_overlap(&b, 1, 0, 0, &c, 2, dx, 4) == collision_mask_overlap(&c, 2, dx, 4, &b, 1, 0, 0);
+	CHECK(symmetric);
+
+	// Source rects of the sheet pick their frame, rects off the grid are clamped to it
+	CHECK(collision_mask_frame(&a, &(SDL_Rect){20, 12, 20, 12}) == 3);
+	CHECK(collision_mask_frame(&b, &(SDL_Rect){100, 0, 50, 10}) == 2);
+	CHECK(collision_mask_frame(&b, &(SDL_Rect){500, 0, 50, 10}) == 2);
+
+	collision_mask_destroy(&a);
+	collision_mask_destroy(&b);
+	collision_mask_destroy(&c);
+	return test_result("collision_mask");
+}
@@ -0,0 +1,139 @@
+#include <stdlib.h>
+
+#include "dirty_rects.h"
+#include "test.h"
+
+#define WIDTH 320
+#define HEIGHT 200
+
+static SDL_FRect random_rect(float max_size) {
+	return (SDL_FRect){test_randf(-40, WIDTH), test_randf(-40, HEIGHT), test_randf(0.5f, max_size), test_randf(0.5f, max_size)};
+}
+
+// Rects disjoint, inside the screen, their area summed, and every pixel touched by an added rect covered
+static void check_rects(const dirty_rects_t *dirty, const SDL_FRect *added, int added_count) {
+	int count;
+	const SDL_Rect *rects = dirty_rects_get(dirty, &count);
+	if (dirty->full) {
+		CHECK(count == 1 && SDL_RectEquals(&rects[0], &dirty->screen));
+		return;
+	}
+
+	static unsigned char covered[HEIGHT][WIDTH];
+	SDL_memset(covered, 0, sizeof(covered));
+	int64_t area = 0;
+	for (int i = 0; i < count; ++i) {
+		const SDL_Rect *r = &rects[i];
+		CHECK(r->w > 0 && r->h > 0 && r->x >= 0 && r->y >= 0 && r->x + r->w <= WIDTH && r->y + r->h <= HEIGHT);
+		for (int j = 0; j < i; ++j)
+			CHECK(!SDL_HasIntersection(r, &rects[j]));
+		for (int y = r->y; y < r->y + r->h; ++y)
+			for (int x = r->x; x < r->x + r->w; ++x)
+				covered[y][x] = 1;
+		area += (int64_t)r->w * r->h;
+	}
+	CHECK(area == dirty->area);
+	CHECK(count <= DIRTY_MAX_RECTS && area * 100 <= (int64_t)WIDTH * HEIGHT * DIRTY_MAX_PERCENT);
+
+	for (int i = 0; i < added_count; ++i) {
+		const SDL_FRect *f = &added[i];
+		const int x0 = SDL_max((int)SDL_floorf(f->x), 0), x1 = SDL_min((int)SDL_ceilf(f->x + f->w), WIDTH);
+		const int y0 = SDL_max((int)SDL_floorf(f->y), 0), y1 = SDL_min((int)SDL_ceilf(f->y + f->h), HEIGHT);
+		bool all = true;
+		for (int y = y0; y < y1; ++y)
+			for (int x = x0; x < x1; ++x)
+				all = all && covered[y][x];
+		CHECK(all);
+	}
+}
+
+static render_item_t item_at(float x, float y) {
+	return (render_item_t){.texture = 1, .whole = true, .dest = {x, y, 10, 10}, .tint = {255, 255, 255, 255}};
+}
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	dirty_rects_t dirty;
+	dirty_rects_init(&dirty);
+
+	// The first frame and a resize are redrawn whole
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	CHECK(dirty.full);
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	CHECK(!dirty.full);
+	dirty_rects_begin(&dirty, WIDTH + 1, HEIGHT);
+	CHECK(dirty.full);
+
+	// Random small rects, merged as they overlap
+	SDL_FRect added[DIRTY_MAX_RECTS * 2];
+	for (int round = 0; round < 500; ++round) {
+		dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+		const int count = test_rand() % (int)SDL_arraysize(added);
+		const float max_size = round % 2 ? 12.0f : 48.0f;
+		for (int i = 0; i < count; ++i) {
+			added[i] = random_rect(max_size);
+			dirty_rects_add(&dirty, &added[i]);
+			check_rects(&dirty, added, i + 1);
+		}
+	}
+
+	// A chain of touching rects becomes one
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	for (int i = 0; i < 5; ++i)
+		dirty_rects_add(&dirty, &(SDL_FRect){10.0f + i * 9.5f, 20, 10, 10});
+	int count;
+	const SDL_Rect *rects = dirty_rects_get(&dirty, &count);
+	CHECK(count == 1 && SDL_RectEquals(&rects[0], &(SDL_Rect){10, 20, 48, 10}));
+
+	// Two rects bridged by a third merge together
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	dirty_rects_add(&dirty, &(SDL_FRect){0, 0, 10, 10});
+	dirty_rects_add(&dirty, &(SDL_FRect){40, 0, 10, 10});
+	dirty_rects_add(&dirty, &(SDL_FRect){5, 5, 40, 2});
+	rects = dirty_rects_get(&dirty, &count);
+	CHECK(count == 1 && SDL_RectEquals(&rects[0], &(SDL_Rect){0, 0, 50, 10}));
+
+	// Rects off the screen change nothing
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	dirty_rects_add(&dirty, &(SDL_FRect){-20, -20, 10, 10});
+	dirty_rects_add(&dirty, &(SDL_FRect){WIDTH, 0, 10, 10});
+	dirty_rects_get(&dirty, &count);
+	CHECK(count == 0 && !dirty.full);
+
+	// More than half the screen redraws all of it
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	dirty_rects_add(&dirty, &(SDL_FRect){0, 0, WIDTH / 2, HEIGHT});
+	CHECK(!dirty.full);
+	dirty_rects_add(&dirty, &(SDL_FRect){WIDTH - 1, 0, 1, 1});
+	CHECK(dirty.full);
+
+	// So do too many separate rects
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	for (int i = 0; i <= DIRTY_MAX_RECTS; ++i)
+		dirty_rects_add(&dirty, &(SDL_FRect){(float)(i % 16) * 20, (float)(i / 16) * 20, 1, 1});
+	CHECK(dirty.full);
+
+	// Unchanged sprites dirty nothing, a moved one dirties where it was and where it is
+	render_item_t items[3] = {item_at(0, 0), item_at(100, 100), item_at(200, 50)};
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	CHECK(dirty_rects_diff(&dirty, items, 3));
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	CHECK(dirty_rects_diff(&dirty, items, 3));
+	dirty_rects_get(&dirty, &count);
+	CHECK(count == 0);
+	items[1].dest.x = 150;
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	CHECK(dirty_rects_diff(&dirty, items, 3));
+	rects = dirty_rects_get(&dirty, &count);
+	CHECK(count == 2 && dirty.area == 200);
+	items[2].tint.a = 128;
+	dirty_rects_begin(&dirty, WIDTH, HEIGHT);
+	CHECK(dirty_rects_diff(&dirty, items, 2));
+	rects = dirty_rects_get(&dirty, &count);
+	CHECK(count == 1 && SDL_RectEquals(&rects[0], &(SDL_Rect){200, 50, 10, 10}));
+
+	dirty_rects_destroy(&dirty);
+	return test_result("dirty_rects");
+}
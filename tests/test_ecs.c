@@ -0,0 +1,228 @@
+#include "ecs.h"
+#include "test.h"
+
+enum { VALUE, PAIR, BLOCK, COMPONENTS };
+
+typedef struct {
+	float x, y;
+} pair_t;
+
+typedef struct {
+	uint8_t bytes[200];						// Few rows per chunk, so entities span many chunks
+} block_t;
+
+#define ENTITIES 2000
+
+// Every live entity is in exactly one chunk row matching its mask, and the counts add up
+static int count_rows(ecs_world_t *world, ecs_mask_t mask) {
+	int count = 0;
+	for (ecs_query_t query = ecs_query(world, mask); ecs_query_next(&query);) {
+		CHECK(ecs_query_count(&query) > 0);
+		const ecs_entity_t *entities = ecs_query_entities(&query);
+		for (int i = 0; i < ecs_query_count(&query); ++i)
+			CHECK(ecs_alive(world, entities[i]));
+		count += ecs_query_count(&query);
+	}
+	return count;
+}
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	const size_t sizes[COMPONENTS] = {sizeof(int), sizeof(pair_t), sizeof(block_t)};
+	ecs_world_t world;
+	CHECK(ecs_init(&world, sizes, COMPONENTS));
+	const ecs_mask_t mask = ECS_COMPONENT(VALUE) | ECS_COMPONENT(BLOCK);
+
+	static ecs_entity_t handles[ENTITIES];
+	for (int i = 0; i < ENTITIES; ++i) {
+		handles[i] = ecs_create(&world, mask);
+		CHECK(handles[i] != ECS_ENTITY_NONE);
+		int *value = ecs_get(&world, handles[i], VALUE);
+		CHECK(value && *value == 0);
+		*value = i;
+		CHECK(ecs_get(&world, handles[i], PAIR) == NULL);
+	}
+	CHECK(world.entity_count == ENTITIES);
+	CHECK(world.archetypes[0].chunk_count > 2);
+	CHECK(count_rows(&world, mask) == ENTITIES);
+
+	// Removing moves the last rows into the holes, every value follows its entity
+	for (int i = 0; i < ENTITIES; i += 3)
+		CHECK(ecs_remove(&world, handles[i]));
+	for (int i = 0; i < ENTITIES; ++i) {
+		const int *value = ecs_get(&world, handles[i], VALUE);
+		CHECK(ecs_alive(&world, handles[i]) == (i % 3 != 0));
+		CHECK(i % 3 == 0 ? value == NULL : value && *value == i);
+	}
+	CHECK(!ecs_remove(&world, handles[0]));
+	CHECK(world.entity_count == ENTITIES - (ENTITIES + 2) / 3);
+	CHECK(count_rows(&world, 0) == world.entity_count);
+
+	// Freed slots come back with a new generation, the old handles stay stale
+	for (int i = 0; i < ENTITIES; i += 3) {
+		ecs_entity_t entity = ecs_create(&world, mask);
+		CHECK(entity != ECS_ENTITY_NONE && entity != handles[i]);
+		CHECK(ecs_alive(&world, entity) && !ecs_alive(&world, handles[i]));
+		*(int *)ecs_get(&world, entity, VALUE) = i;
+		handles[i] = entity;
+	}
+	CHECK(world.slot_count == ENTITIES);
+	CHECK(world.entity_count == ENTITIES);
+
+	// Adding and removing components keeps the values of the others, the added one starts zeroed
+	for (int i = 0; i < ENTITIES; i += 2) {
+		CHECK(ecs_add_component(&world, handles[i], PAIR));
+		pair_t *pair = ecs_get(&world, handles[i], PAIR);
+		CHECK(pair && pair->x == 0 && pair->y == 0);
+		*pair = (pair_t){(float)i, -(float)i};
+	}
+	CHECK(count_rows(&world, mask | ECS_COMPONENT(PAIR)) == ENTITIES / 2);
+	CHECK(count_rows(&world, mask) == ENTITIES);
+	for (int i = 0; i < ENTITIES; i += 4)
+		CHECK(ecs_remove_component(&world, handles[i], BLOCK));
+	for (int i = 0; i < ENTITIES; ++i) {
+		CHECK(*(int *)ecs_get(&world, handles[i], VALUE) == i);
+		const pair_t *pair = ecs_get(&world, handles[i], PAIR);
+		CHECK(i % 2 == 0 ? pair && pair->x == (float)i && pair->y == -(float)i : pair == NULL);
+		CHECK((ecs_get(&world, handles[i], BLOCK) == NULL) == (i % 4 == 0));
+	}
+	CHECK(count_rows(&world, ECS_COMPONENT(PAIR)) == ENTITIES / 2);
+	CHECK(count_rows(&world, 0) == ENTITIES);
+
+	// Chunks of one query can be taken apart for other threads
+	ecs_query_t chunks[256];
+	int chunk_count = ecs_query_chunks(&world, ECS_COMPONENT(VALUE), chunks, 256);
+	CHECK(chunk_count <= 256);
+	int rows = 0;
+	for (int i = 0; i < chunk_count; ++i)
+		rows += ecs_query_count(&chunks[i]);
+	CHECK(rows == ENTITIES);
+
+	// A slot reused over and over never hands out ECS_ENTITY_NONE, and an old handle only comes back
+	// once the generations wrap around
+	const int generations = 1 << (32 - ECS_SLOT_BITS);
+	ecs_entity_t first = handles[1];
+	CHECK(ecs_remove(&world, first));
+	bool unique = true;
+	for (int i = 0; i < 2 * generations; ++i) {
+		ecs_entity_t entity = ecs_create(&world, mask);
+		unique &= entity != ECS_ENTITY_NONE && (entity & (ECS_MAX_ENTITIES - 1)) == (first & (ECS_MAX_ENTITIES - 1));
+		unique &= i >= generations - 2 || entity != first;
+		CHECK(ecs_remove(&world, entity));
+		unique &= !ecs_alive(&world, entity);
+	}
+	CHECK(unique);
+
+	// Stale and made up handles are refused everywhere
+	CHECK(!ecs_alive(&world, ECS_ENTITY_NONE));
+	CHECK(ecs_get(&world, ECS_ENTITY_NONE, VALUE) == NULL);
+	CHECK(!ecs_add_component(&world, first, PAIR));
+	CHECK(!ecs_remove_component(&world, first, VALUE));
+	CHECK(!ecs_alive(&world, (ecs_entity_t)1 << ECS_SLOT_BITS | (ECS_MAX_ENTITIES - 1)));
+
+	ecs_destroy(&world);
+
+	// Reserved slots, chunks and chunk tables are not moved by creating entities, and emptied
+	// chunks are reused before any other
+	CHECK(ecs_init(&world, sizes, COMPONENTS));
+	CHECK(ecs_reserve(&world, mask, ENTITIES));
+	ecs_archetype_t *archetype = &world.archetypes[0];
+	const int capacity = archetype->capacity;
+	const int reserved = (ENTITIES + capacity - 1) / capacity;
+	CHECK(archetype->chunk_count == 0 && archetype->free_count == reserved && archetype->chunk_capacity == reserved);
+	const ecs_slot_t *slots = world.slots;
+	ecs_chunk_t **table = archetype->chunks;
+	for (int i = 0; i < ENTITIES; ++i)
+		handles[i] = ecs_create(&world, mask);
+	CHECK(archetype->chunk_count == reserved && archetype->free_count == 0);
+	CHECK(world.slots == slots && world.slot_capacity == ENTITIES && archetype->chunks == table);
+
+	// A burst of removals keeps the chunks, the next burst takes them back
+	ecs_chunk_t *second = archetype->chunks[1];
+	for (int i = capacity; i < ENTITIES; ++i)
+		CHECK(ecs_remove(&world, handles[i]));
+	CHECK(archetype->chunk_count == 1 && archetype->free_count == reserved - 1);
+	for (int i = capacity; i < ENTITIES; ++i)
+		handles[i] = ecs_create(&world, mask);
+	CHECK(archetype->chunk_count == reserved && archetype->free_count == 0 && archetype->chunks == table);
+	bool reused = false;
+	for (int i = 0; i < archetype->chunk_count; ++i)
+		reused = reused || archetype->chunks[i] == second;
+	CHECK(reused);
+
+	// Room left in the last chunk and free chunks count, another archetype gets its own chunks
+	CHECK(ecs_reserve(&world, mask, capacity * reserved - ENTITIES));
+	CHECK(archetype->free_count == 0);
+	CHECK(ecs_reserve(&world, mask, capacity * reserved - ENTITIES + 1));
+	CHECK(archetype->free_count == 1);
+	CHECK(ecs_add_component(&world, handles[0], PAIR));
+	CHECK(ecs_remove_component(&world, handles[0], PAIR));
+	CHECK(world.archetypes[1].chunk_count == 0 && world.archetypes[1].free_count == 1);
+	CHECK(!ecs_reserve(&world, mask, ECS_MAX_ENTITIES));
+	ecs_destroy(&world);
+
+	// Deferred changes wait for the flush and are applied in order
+	CHECK(ecs_init(&world, sizes, COMPONENTS));
+	ecs_commands_t commands;
+	ecs_commands_init(&commands);
+	ecs_entity_t keep = ecs_create(&world, mask), gone = ecs_create(&world, mask);
+	*(int *)ecs_get(&world, gone, VALUE) = 7;
+	const pair_t pair = {1.5f, -2.5f};
+	const int value = 42;
+	CHECK(ecs_defer_destroy(&commands, gone));
+	CHECK(ecs_defer_set(&commands, gone, VALUE, &value, sizeof(value)));
+	CHECK(ecs_defer_create(&commands, ECS_COMPONENT(VALUE) | ECS_COMPONENT(PAIR)));
+	CHECK(ecs_defer_set(&commands, ECS_ENTITY_NONE, PAIR, &pair, sizeof(pair)));
+	CHECK(ecs_defer_set(&commands, ECS_ENTITY_NONE, VALUE, &value, sizeof(value)));
+	CHECK(ecs_defer_add(&commands, keep, PAIR));
+	CHECK(ecs_defer_set(&commands, keep, PAIR, &pair, sizeof(pair)));
+	CHECK(ecs_defer_remove(&commands, keep, BLOCK));
+	CHECK(ecs_alive(&world, gone) && world.entity_count == 2 && ecs_get(&world, keep, PAIR) == NULL);
+	ecs_flush(&world, &commands);
+	CHECK(commands.size == 0);
+	CHECK(!ecs_alive(&world, gone) && world.entity_count == 2);
+	const pair_t *kept = ecs_get(&world, keep, PAIR);
+	CHECK(kept && kept->x == pair.x && kept->y == pair.y && ecs_get(&world, keep, BLOCK) == NULL);
+	int created = 0;
+	for (ecs_query_t query = ecs_query(&world, ECS_COMPONENT(VALUE) | ECS_COMPONENT(PAIR)); ecs_query_next(&query);) {
+		const int *values = ecs_query_column(&query, VALUE);
+		const pair_t *pairs = ecs_query_column(&query, PAIR);
+		for (int i = 0; i < ecs_query_count(&query); ++i) {
+			if (ecs_query_entities(&query)[i] == keep)
+				continue;
+			CHECK(values[i] == value && pairs[i].x == pair.x && pairs[i].y == pair.y);
+			++created;
+		}
+	}
+	CHECK(created == 1);
+
+	// Replacing entities through the buffer keeps the population in its reserved chunks
+	ecs_world_t pool;
+	CHECK(ecs_init(&pool, sizes, COMPONENTS));
+	CHECK(ecs_reserve(&pool, mask, ENTITIES));
+	for (int i = 0; i < ENTITIES; ++i)
+		handles[i] = ecs_create(&pool, mask);
+	ecs_chunk_t **pool_chunks = pool.archetypes[0].chunks;
+	for (int round = 0; round < 10; ++round) {
+		int live = 0;
+		for (ecs_query_t query = ecs_query(&pool, mask); ecs_query_next(&query);)
+			for (int i = 0; i < ecs_query_count(&query); ++i)
+				handles[live++] = ecs_query_entities(&query)[i];
+		CHECK(live == ENTITIES);
+		for (int i = round % 3; i < ENTITIES; i += 3) {
+			CHECK(ecs_defer_destroy(&commands, handles[i]));
+			CHECK(ecs_defer_create(&commands, mask));
+			CHECK(ecs_defer_set(&commands, ECS_ENTITY_NONE, VALUE, &i, sizeof(i)));
+		}
+		ecs_flush(&pool, &commands);
+		CHECK(pool.entity_count == ENTITIES && pool.archetypes[0].chunks == pool_chunks);
+		CHECK(pool.slot_capacity == ENTITIES && pool.archetypes[0].free_count == 0);
+	}
+	CHECK(count_rows(&pool, mask) == ENTITIES);
+	ecs_destroy(&pool);
+	ecs_commands_destroy(&commands);
+	ecs_destroy(&world);
+	return test_result("ecs");
+}
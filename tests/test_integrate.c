@@ -0,0 +1,61 @@
+#include <string.h>
+
+#include "integrate.h"
+#include "test.h"
+
+#define MAX_ACTORS 67
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	TEST_VARIANTS(integrate, integrate_fn, variants, variant_count);
+	CHECK(variants[0] == integrate_scalar);
+	const float limit[2] = {640, 360};
+
+	// Every count up to a few vectors, so each tail length of the SSE2 and AVX2 loops is run
+	for (int count = 0; count <= MAX_ACTORS; ++count) {
+		float extent[MAX_ACTORS * 2], bounce[MAX_ACTORS * 2], position[MAX_ACTORS * 2], velocity[MAX_ACTORS * 2];
+		for (int i = 0; i < count * 2; ++i) {
+			extent[i] = test_randf(8, 64);
+			bounce[i] = test_rand() % 2 ? -1.0f : 0.0f;
+			position[i] = test_randf(-80, 700);
+			velocity[i] = test_randf(-400, 400);
+		}
+
+		float expected_position[MAX_ACTORS * 2], expected_velocity[MAX_ACTORS * 2];
+		memcpy(expected_position, position, sizeof(position));
+		memcpy(expected_velocity, velocity, sizeof(velocity));
+		for (int step = 0; step < 4; ++step)
+			integrate_scalar(expected_position, expected_velocity, extent, bounce, count, 0.1f, limit);
+
+		// Actors stay inside the limits
+		for (int i = 0; i < count * 2; ++i)
+			CHECK(expected_position[i] >= 0 && expected_position[i] <= limit[i & 1] - extent[i]);
+
+		for (int v = 1; v < variant_count; ++v) {
+			float moved_position[MAX_ACTORS * 2], moved_velocity[MAX_ACTORS * 2];
+			memcpy(moved_position, position, sizeof(position));
+			memcpy(moved_velocity, velocity, sizeof(velocity));
+			for (int step = 0; step < 4; ++step)
+				variants[v](moved_position, moved_velocity, extent, bounce, count, 0.1f, limit);
+			const size_t bytes = sizeof(float) * 2 * (size_t)count;
+			CHECK(memcmp(moved_position, expected_position, bytes) == 0);
+			CHECK(memcmp(moved_velocity, expected_velocity, bytes) == 0);
+		}
+	}
+
+	// Edges hit on each axis alone, the first actor turns back and the second one stops
+	float extent[4] = {10, 10, 10, 10};
+	float bounce[4] = {-1, -1, 0, 0};
+	float position[4] = {-5, 100, 100, 355};
+	float velocity[4] = {-1, 2, 3, 4};
+	integrate_scalar(position, velocity, extent, bounce, 2, 1.0f, limit);
+	CHECK(position[0] == 0 && velocity[0] == 1);
+	CHECK(position[1] == 102 && velocity[1] == 2);
+	CHECK(position[2] == 103 && velocity[2] == 3);
+	CHECK(position[3] == 350 && velocity[3] == 0);
+
+	CHECK(integrate_bench(1001));
+	return test_result("integrate");
+}
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+
+#include "job.h"
+#include "test.h"
+
+#define THREADS 8
+#define INDEXES 100000						// More jobs than a deque holds, the overflow runs inline
+#define ROUNDS 20
+#define PARENTS 256
+#define CHILDREN 64
+
+static job_system_t jobs;
+static atomic_int hits[INDEXES];
+
+static void count_hits(void *data, int begin, int end) {
+	(void)data;
+	for (int i = begin; i < end; ++i)
+		atomic_fetch_add(&hits[i], 1);
+}
+
+// Children are pushed on the deque of the worker running the parent, so the owner takes them
+// while the other workers steal them from the other end
+static job_t children[PARENTS][CHILDREN];
+static job_counter_t children_done;
+
+static void spawn_children(void *data, int begin, int end) {
+	(void)data;
+	for (int parent = begin; parent < end; ++parent)
+		for (int i = 0; i < CHILDREN; ++i) {
+			children[parent][i] = (job_t){.fn = count_hits, .begin = parent * CHILDREN + i, .end = parent * CHILDREN + i + 1,
+										  .done = &children_done};
+			job_run(&jobs, &children[parent][i], NULL);
+		}
+}
+
+// Second stage of a chain, every index of the first stage must be done before it starts
+static atomic_int order_errors;
+
+static void check_first_stage(void *data, int begin, int end) {
+	(void)data;
+	for (int i = begin; i < end; ++i)
+		if (atomic_load(&hits[i]) != 1)
+			atomic_fetch_add(&order_errors, 1);
+}
+
+static bool hit_once(int count) {
+	bool once = true;
+	for (int i = 0; i < count; ++i) {
+		once &= atomic_load(&hits[i]) == 1;
+		atomic_store(&hits[i], 0);
+	}
+	return once;
+}
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	CHECK(job_system_init(&jobs, THREADS));
+	static job_t range[INDEXES], after[INDEXES];
+
+	// Every index runs exactly once however the jobs are taken and stolen
+	for (int round = 0; round < ROUNDS; ++round) {
+		job_counter_t done;
+		job_counter_init(&done);
+		CHECK(job_parallel_for(&jobs, range, INDEXES, 1 + round % 3, count_hits, NULL, &done, NULL) == (INDEXES + round % 3) / (1 + round % 3));
+		job_wait(&jobs, &done);
+		CHECK(job_counter_done(&done));
+		CHECK(hit_once(INDEXES));
+	}
+
+	// Jobs queued from the workers themselves
+	for (int round = 0; round < ROUNDS; ++round) {
+		static job_t parents[PARENTS];
+		job_counter_t done;
+		job_counter_init(&done);
+		job_counter_init(&children_done);
+		// Held up by the main thread until every child is queued, or the count could reach zero early
+		atomic_fetch_add(&children_done.pending, 1);
+		job_parallel_for(&jobs, parents, PARENTS, 1, spawn_children, NULL, &done, NULL);
+		job_wait(&jobs, &done);
+		atomic_fetch_sub(&children_done.pending, 1);
+		job_wait(&jobs, &children_done);
+		CHECK(hit_once(PARENTS * CHILDREN));
+	}
+
+	// A stage held on the counter of another starts after all of it
+	for (int round = 0; round < ROUNDS; ++round) {
+		job_counter_t first, second;
+		job_counter_init(&first);
+		job_counter_init(&second);
+		job_parallel_for(&jobs, range, INDEXES / 4, 16, count_hits, NULL, &first, NULL);
+		job_parallel_for(&jobs, after, INDEXES / 4, 16, check_first_stage, NULL, &second, &first);
+		job_wait(&jobs, &second);
+		CHECK(job_counter_done(&first));
+		CHECK(hit_once(INDEXES / 4));
+	}
+	CHECK(atomic_load(&order_errors) == 0);
+
+	// An empty range uses one job and still holds back the stage after it
+	job_t empty[1];
+	job_counter_t nothing, last;
+	job_counter_init(&nothing);
+	job_counter_init(&last);
+	CHECK(job_parallel_for(&jobs, empty, 0, 8, count_hits, NULL, &nothing, NULL) == 1);
+	CHECK(job_parallel_for(&jobs, range, 100, 8, count_hits, NULL, &last, &nothing) == 13);
+	job_wait(&jobs, &last);
+	CHECK(job_counter_done(&nothing));
+	CHECK(hit_once(100));
+
+	job_system_destroy(&jobs);
+	return test_result("job");
+}
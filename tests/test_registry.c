@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "registry.h"
+#include "test.h"
+
+#define MANIFEST "tests/registry.manifest"
+#define SPECIES 1000
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	// Many similar names, so the first hash puts several of them in the same bucket
+	FILE *file = fopen(MANIFEST, "w");
+	CHECK(file != NULL);
+	if (!file)
+		return test_result("registry");
+	fprintf(file, "# Generated by test_registry\n\n");
+	for (int i = 0; i < SPECIES; ++i)
+		fprintf(file, "animal%d player/none.png builtin %d 1\n", i, i);
+	fclose(file);
+
+	registry_t registry;
+	CHECK(registry_load(&registry, MANIFEST));
+	remove(MANIFEST);
+	CHECK(registry.count == SPECIES);
+
+	// Every name finds its own id, and lands in a slot of its own
+	int found = 0;
+	for (int i = 0; i < registry.count; ++i) {
+		char name[SPECIES_NAME_SIZE];
+		snprintf(name, sizeof(name), "animal%d", i);
+		int id = registry_find(&registry, name);
+		CHECK(id == i);
+		found += id == i;
+		CHECK(registry_get(&registry, i)->speed == (float)i);
+	}
+	CHECK(found == SPECIES);
+	int used = 0;
+	for (uint32_t slot = 0; slot <= registry.slot_mask; ++slot)
+		used += registry.slots[slot] != SPECIES_NONE;
+	CHECK(used == SPECIES);
+
+	// Names that are not there, the close ones included
+	CHECK(registry_find(&registry, "animal") == SPECIES_NONE);
+	CHECK(registry_find(&registry, "animal1000") == SPECIES_NONE);
+	CHECK(registry_find(&registry, "animal01") == SPECIES_NONE);
+	CHECK(registry_find(&registry, "") == SPECIES_NONE);
+	CHECK(registry_get(&registry, SPECIES) == NULL);
+	CHECK(registry_get(&registry, -1) == NULL);
+	registry_destroy(&registry);
+
+	// Duplicated names make the manifest invalid
+	file = fopen(MANIFEST, "w");
+	if (file) {
+		fprintf(file, "cat player/cat.png builtin 1 1\ncat player/cat.png builtin 1 1\n");
+		fclose(file);
+	}
+	CHECK(!registry_load(&registry, MANIFEST));
+	remove(MANIFEST);
+	return test_result("registry");
+}
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+
+#include "render_queue.h"
+#include "test.h"
+
+#define ITEMS 5000
+
+// What the keys are made of, sorted with a comparator as the reference
+typedef struct {
+	int layer, texture;
+	float depth;
+	int sequence;
+} submitted_t;
+
+static int compare_submitted(const void *a, const void *b) {
+	const submitted_t *x = a, *y = b;
+	if (x->layer != y->layer)
+		return x->layer - y->layer;
+	if (x->texture != y->texture)
+		return x->texture - y->texture;
+	if (x->depth != y->depth)
+		return x->depth < y->depth ? -1 : 1;
+	return x->sequence - y->sequence;
+}
+
+// Submits count sprites, the sequence is written to the x of dest so the sorted items can be told apart
+static void submit(render_queue_t *queue, submitted_t *submitted, int count, int layers, int textures, int depths) {
+	render_queue_clear(queue);
+	for (int i = 0; i < count; ++i) {
+		// Whole depths, so the 24 bits kept of them never merge two of them
+		submitted[i] = (submitted_t){
+			.layer = (int)(test_rand() % (unsigned)layers),
+			.texture = (int)(test_rand() % (unsigned)textures),
+			.depth = (float)((int)(test_rand() % (unsigned)depths) - depths / 2),
+			.sequence = i,
+		};
+		SDL_FRect dest = {(float)i, 0, 1, 1};
+		CHECK(render_queue_submit(queue, submitted[i].layer, submitted[i].depth, submitted[i].texture, NULL, &dest,
+								  (SDL_Color){255, 255, 255, 255}, SDL_FLIP_NONE));
+	}
+}
+
+static bool sorted_like(render_queue_t *queue, submitted_t *submitted, int count) {
+	render_queue_sort(queue);
+	qsort(submitted, (size_t)count, sizeof(submitted_t), compare_submitted);
+	bool same = queue->count == count;
+	for (int i = 0; same && i < count; ++i) {
+		const render_item_t *item = render_queue_item(queue, i);
+		same &= (int)item->dest.x == submitted[i].sequence && item->texture == submitted[i].texture;
+	}
+	return same;
+}
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	static submitted_t submitted[ITEMS];
+	render_queue_t queue;
+	CHECK(render_queue_init(&queue));
+
+	// Layers first, then textures, then back to front, then submission order
+	submit(&queue, submitted, ITEMS, RENDER_LAYERS, 40, 2000);
+	CHECK(sorted_like(&queue, submitted, ITEMS));
+
+	// Few distinct values, many ties left in submission order
+	submit(&queue, submitted, ITEMS, 2, 3, 5);
+	CHECK(sorted_like(&queue, submitted, ITEMS));
+
+	// Digits every key shares are skipped, one layer and one texture sort by depth alone
+	submit(&queue, submitted, ITEMS, 1, 1, 30000);
+	CHECK(sorted_like(&queue, submitted, ITEMS));
+	submit(&queue, submitted, ITEMS, 1, 1, 1);
+	CHECK(sorted_like(&queue, submitted, ITEMS));
+
+	// Every small count, the sort stops early for less than two keys
+	for (int count = 0; count < 20; ++count) {
+		submit(&queue, submitted, count, 3, 3, 8);
+		CHECK(sorted_like(&queue, submitted, count));
+	}
+
+	// Fractions and negative depths keep their order too
+	const float depths[] = {0.5f, -0.25f, 1e6f, -1e6f, 0.0f, -3.75f, 12.5f, 0.125f};
+	const int depth_count = (int)(sizeof(depths) / sizeof(depths[0]));
+	render_queue_clear(&queue);
+	for (int i = 0; i < depth_count; ++i) {
+		submitted[i] = (submitted_t){.layer = 0, .texture = 0, .depth = depths[i], .sequence = i};
+		SDL_FRect dest = {(float)i, 0, 1, 1};
+		render_queue_submit(&queue, 0, depths[i], 0, NULL, &dest, (SDL_Color){0}, SDL_FLIP_NONE);
+	}
+	CHECK(sorted_like(&queue, submitted, depth_count));
+
+	// Source rects are kept, NULL draws the whole texture
+	render_queue_clear(&queue);
+	SDL_Rect src = {1, 2, 3, 4};
+	SDL_FRect dest = {0, 0, 1, 1};
+	render_queue_submit(&queue, 1, 0, 7, &src, &dest, (SDL_Color){0}, SDL_FLIP_HORIZONTAL);
+	render_queue_submit(&queue, 0, 0, 7, NULL, &dest, (SDL_Color){0}, SDL_FLIP_NONE);
+	render_queue_sort(&queue);
+	CHECK(render_queue_item(&queue, 0)->whole);
+	CHECK(!render_queue_item(&queue, 1)->whole && SDL_RectEquals(&render_queue_item(&queue, 1)->src, &src));
+	CHECK(render_queue_item(&queue, 1)->flip == SDL_FLIP_HORIZONTAL);
+
+	render_queue_destroy(&queue);
+	return test_result("render_queue");
+}
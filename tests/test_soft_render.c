@@ -0,0 +1,59 @@
+#include <string.h>
+
+#include "soft_render.h"
+#include "test.h"
+
+#define ROW_WIDTH 37
+#define MAX_SPAN 70
+
+// Random premultiplied pixel, with the fully transparent and opaque alphas more likely
+static uint32_t random_pixel(void) {
+	const int pick = test_rand() % 4;
+	const uint32_t alpha = pick == 0 ? 0 : pick == 1 ? 255 : (uint32_t)test_rand() % 256;
+	uint32_t pixel = alpha << 24;
+	for (int shift = 0; shift < 24; shift += 8)
+		pixel |= ((uint32_t)test_rand() % (alpha + 1)) << shift;
+	return pixel;
+}
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	TEST_VARIANTS(soft_span, soft_span_fn, spans, span_count);
+
+	// An opaque source replaces the target, a transparent one keeps it
+	uint32_t row[ROW_WIDTH] = {0xFF102030, 0x00000000};
+	uint32_t dst[2] = {0xFFFFFFFF, 0x80402010};
+	spans[0](dst, row, (const int[]){0, 1}, 2);
+	CHECK(dst[0] == 0xFF102030 && dst[1] == 0x80402010);
+
+	// Every length up to a few vectors, so the SSE2 and AVX2 loops end on each tail length
+	for (int count = 0; count <= MAX_SPAN; ++count) {
+		for (int round = 0; round < 20; ++round) {
+			int columns[MAX_SPAN];
+			uint32_t target[MAX_SPAN + 1];
+			for (int i = 0; i < ROW_WIDTH; ++i)
+				row[i] = random_pixel();
+			for (int i = 0; i < count; ++i) {
+				columns[i] = test_rand() % ROW_WIDTH;
+				target[i] = random_pixel();
+			}
+			target[count] = 0xDEADBEEF;
+
+			uint32_t expected[MAX_SPAN + 1];
+			memcpy(expected, target, sizeof(target));
+			spans[0](expected, row, columns, count);
+			CHECK(expected[count] == 0xDEADBEEF);
+
+			for (int v = 1; v < span_count; ++v) {
+				uint32_t blended[MAX_SPAN + 1];
+				memcpy(blended, target, sizeof(target));
+				spans[v](blended, row, columns, count);
+				CHECK(memcmp(blended, expected, sizeof(blended)) == 0);
+			}
+		}
+	}
+
+	return test_result("soft_render");
+}
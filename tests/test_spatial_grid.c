@@ -0,0 +1,137 @@
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "spatial_grid.h"
+#include "test.h"
+
+#define POINTS 3000
+#define QUERIES 500
+
+static float xs[POINTS], ys[POINTS];
+
+static int compare_ids(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static int compare_floats(const void *a, const void *b) {
+	float x = *(const float *)a, y = *(const float *)b;
+	return (x > y) - (x < y);
+}
+
+// Same ids in any order
+static bool same_ids(uint32_t *found, int found_count, uint32_t *expected, int expected_count) {
+	if (found_count != expected_count)
+		return false;
+	qsort(found, (size_t)found_count, sizeof(uint32_t), compare_ids);
+	qsort(expected, (size_t)expected_count, sizeof(uint32_t), compare_ids);
+	for (int i = 0; i < found_count; ++i)
+		if (found[i] != expected[i])
+			return false;
+	return true;
+}
+
+static float distance2(int id, float x, float y) {
+	float dx = xs[id] - x, dy = ys[id] - y;
+	return dx * dx + dy * dy;
+}
+
+// Every query against a brute force pass over the points
+static void check_queries(const spatial_grid_t *grid, int count) {
+	static uint32_t found[POINTS], expected[POINTS];
+	for (int q = 0; q < QUERIES; ++q) {
+		// Queries around and outside the grid too, where cells are clamped to the border
+		float x = test_randf(-300, 1300), y = test_randf(-300, 1000);
+		float w = test_randf(0, 400), h = test_randf(0, 400);
+
+		int expected_count = 0;
+		for (int i = 0; i < count; ++i)
+			if (xs[i] >= x && xs[i] <= x + w && ys[i] >= y && ys[i] <= y + h)
+				expected[expected_count++] = (uint32_t)i;
+		int found_count = spatial_grid_query_rect(grid, x, y, x + w, y + h, found, POINTS);
+		CHECK(same_ids(found, found_count, expected, expected_count));
+
+		float radius = w * 0.5f;
+		expected_count = 0;
+		for (int i = 0; i < count; ++i)
+			if (distance2(i, x, y) <= radius * radius)
+				expected[expected_count++] = (uint32_t)i;
+		found_count = spatial_grid_query_radius(grid, x, y, radius, found, POINTS);
+		CHECK(same_ids(found, found_count, expected, expected_count));
+
+		// Nearest points: same distances as the k smallest of all, ties may swap ids
+		int k = 1 + (int)(test_rand() % SPATIAL_GRID_MAX_NEAREST);
+		static float all[POINTS];
+		for (int i = 0; i < count; ++i)
+			all[i] = distance2(i, x, y);
+		qsort(all, (size_t)count, sizeof(float), compare_floats);
+		uint32_t nearest[SPATIAL_GRID_MAX_NEAREST];
+		int nearest_count = spatial_grid_nearest(grid, x, y, k, nearest);
+		CHECK(nearest_count == SDL_min(k, count));
+		bool same = true;
+		for (int i = 0; i < nearest_count; ++i)
+			same &= distance2((int)nearest[i], x, y) == all[i];
+		CHECK(same);
+	}
+}
+
+static void build(spatial_grid_t *grid, int count) {
+	CHECK(spatial_grid_begin(grid, count));
+	for (int i = 0; i < count; ++i)
+		spatial_grid_insert(grid, (uint32_t)i, xs[i], ys[i]);
+	spatial_grid_end(grid);
+}
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	// 1000 x 700 in cells of 64, the last row and column are partly outside
+	spatial_grid_t grid;
+	CHECK(spatial_grid_init(&grid, 0, 0, 1000, 700, 64));
+	CHECK(grid.columns == 16 && grid.rows == 11);
+
+	// A few points outside the grid, kept in the border cells
+	for (int i = 0; i < POINTS; ++i) {
+		xs[i] = i % 10 ? test_randf(0, 1000) : test_randf(-200, 1200);
+		ys[i] = i % 10 ? test_randf(0, 700) : test_randf(-200, 900);
+	}
+	build(&grid, POINTS);
+	check_queries(&grid, POINTS);
+
+	// Points moving within their cells keep the last order, points changing cells sort again
+	for (int i = 0; i < POINTS; ++i) {
+		float cell_x = SDL_floorf(xs[i] / 64) * 64, cell_y = SDL_floorf(ys[i] / 64) * 64;
+		if (xs[i] >= 0 && xs[i] < 1000 && ys[i] >= 0 && ys[i] < 700) {
+			xs[i] = SDL_min(cell_x + test_randf(0, 64), 999.0f);
+			ys[i] = SDL_min(cell_y + test_randf(0, 64), 699.0f);
+		}
+	}
+	build(&grid, POINTS);
+	CHECK(!grid.changed);
+	check_queries(&grid, POINTS);
+	for (int i = 0; i < POINTS; i += 7)
+		xs[i] = test_randf(-100, 1100);
+	build(&grid, POINTS);
+	CHECK(grid.changed);
+	check_queries(&grid, POINTS);
+
+	// Fewer points than asked for, and all of them far from the query, so every ring is searched
+	build(&grid, 5);
+	check_queries(&grid, 5);
+	uint32_t ids[SPATIAL_GRID_MAX_NEAREST];
+	CHECK(spatial_grid_nearest(&grid, 5000, 5000, 10, ids) == 5);
+	CHECK(spatial_grid_nearest(&grid, 0, 0, 0, ids) == 0);
+
+	// Capacity only limits what is written
+	build(&grid, POINTS);
+	uint32_t few[4];
+	CHECK(spatial_grid_query_rect(&grid, -1000, -1000, 3000, 3000, few, 4) == POINTS);
+	build(&grid, 0);
+	CHECK(spatial_grid_query_radius(&grid, 500, 350, 1000, few, 4) == 0);
+	CHECK(spatial_grid_nearest(&grid, 500, 350, 4, few) == 0);
+
+	spatial_grid_destroy(&grid);
+	return test_result("spatial_grid");
+}
@@ -0,0 +1,125 @@
+#include <stdlib.h>
+
+#include "sweep.h"
+#include "test.h"
+
+#define MAX_BOXES 2000
+
+static float boxes[MAX_BOXES][4];
+
+// Every overlapping pair by brute force, a bit per pair
+static unsigned char expected[MAX_BOXES][MAX_BOXES];
+
+static void fill(int count, float world, float size) {
+	for (int i = 0; i < count; ++i) {
+		boxes[i][0] = test_randf(0, world);
+		boxes[i][1] = test_randf(0, world);
+		boxes[i][2] = boxes[i][0] + test_randf(1, size);
+		boxes[i][3] = boxes[i][1] + test_randf(1, size);
+	}
+}
+
+// Boxes touching on an edge overlap too
+static bool overlap(int a, int b) {
+	return boxes[a][0] <= boxes[b][2] && boxes[b][0] <= boxes[a][2] && boxes[a][1] <= boxes[b][3] && boxes[b][1] <= boxes[a][3];
+}
+
+static bool run(sweep_t *sweep, int count) {
+	if (!sweep_begin(sweep, count))
+		return false;
+	for (int i = 0; i < count; ++i)
+		sweep_insert(sweep, (uint32_t)i, boxes[i][0], boxes[i][1], boxes[i][2], boxes[i][3]);
+	return sweep_end(sweep);
+}
+
+// The scalar sweep finds every pair of the brute force, once each and with the smaller min x first
+static void check_scalar(sweep_t *sweep, int count) {
+	int pairs = 0;
+	for (int a = 0; a < count; ++a)
+		for (int b = 0; b < count; ++b)
+			expected[a][b] = a != b && overlap(a, b);
+	for (int a = 0; a < count; ++a)
+		for (int b = a + 1; b < count; ++b)
+			pairs += expected[a][b];
+
+	CHECK(run(sweep, count));
+	CHECK(sweep->pair_count == pairs);
+	bool found = true;
+	for (int i = 0; i < sweep->pair_count; ++i) {
+		uint32_t a = sweep->pairs[i].a, b = sweep->pairs[i].b;
+		found &= a < (uint32_t)count && b < (uint32_t)count && expected[a][b] && boxes[a][0] <= boxes[b][0];
+		if (a < (uint32_t)count && b < (uint32_t)count)
+			expected[a][b] = expected[b][a] = 0;
+	}
+	CHECK(found);
+}
+
+// Same pairs in the same order from every variant, against a scalar sweep over the same boxes
+static void check_variants(sweep_t *sweeps, int variant_count, int count) {
+	for (int v = 0; v < variant_count; ++v)
+		CHECK(run(&sweeps[v], count));
+	bool same = true;
+	for (int v = 1; v < variant_count; ++v) {
+		same &= sweeps[v].pair_count == sweeps[0].pair_count;
+		for (int i = 0; same && i < sweeps[0].pair_count; ++i)
+			same &= sweeps[v].pairs[i].a == sweeps[0].pairs[i].a && sweeps[v].pairs[i].b == sweeps[0].pairs[i].b;
+	}
+	CHECK(same);
+}
+
+int main(int argc, char *argv[]) {
+	(void)argc;
+	(void)argv;
+
+	TEST_VARIANTS(sweep, sweep_fn, variants, variant_count);
+	sweep_t sweeps[SIMD_VARIANTS];
+	for (int v = 0; v < variant_count; ++v) {
+		CHECK(sweep_init(&sweeps[v]));
+		sweeps[v].run = variants[v];
+	}
+	sweep_t reference;
+	CHECK(sweep_init(&reference));
+	CHECK(reference.run == variants[variant_count - 1]);
+	reference.run = variants[0];
+
+	// Every count up to a few vectors, so the blocks of 4 and 8 end on each tail length.
+	// Dense boxes overlap past whole blocks, sparse ones stop inside the first.
+	for (int count = 0; count <= 40; ++count) {
+		fill(count, 100, 60);
+		check_scalar(&reference, count);
+		check_variants(sweeps, variant_count, count);
+		fill(count, 1000, 40);
+		check_scalar(&reference, count);
+		check_variants(sweeps, variant_count, count);
+	}
+
+	// Many boxes, then the same boxes moved a little (insertion sort from the last order) and a lot (sorted again)
+	fill(MAX_BOXES, 4000, 80);
+	check_scalar(&reference, MAX_BOXES);
+	check_variants(sweeps, variant_count, MAX_BOXES);
+	for (int i = 0; i < MAX_BOXES; ++i) {
+		float dx = test_randf(-3, 3);
+		boxes[i][0] += dx;
+		boxes[i][2] += dx;
+	}
+	check_scalar(&reference, MAX_BOXES);
+	check_variants(sweeps, variant_count, MAX_BOXES);
+	fill(MAX_BOXES, 4000, 80);
+	check_scalar(&reference, MAX_BOXES);
+	check_variants(sweeps, variant_count, MAX_BOXES);
+
+	// Boxes sharing one min x, a block where every lane hits on x
+	for (int i = 0; i < 37; ++i) {
+		boxes[i][0] = 10;
+		boxes[i][2] = 20;
+		boxes[i][1] = (float)(i * 5);
+		boxes[i][3] = (float)(i * 5 + 7);
+	}
+	check_scalar(&reference, 37);
+	check_variants(sweeps, variant_count, 37);
+
+	for (int v = 0; v < variant_count; ++v)
+		sweep_destroy(&sweeps[v]);
+	sweep_destroy(&reference);
+	return test_result("sweep");
+}
@@ -0,0 +1,158 @@
+#include "texture_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t hash_key(const char *key) {
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (; *key; ++key)
+		hash = (hash ^ (uint8_t)*key) * 16777619u;
+	return hash;
+}
+
+static size_t texture_bytes(SDL_Texture *texture) {
+	uint32_t format;
+	int w, h;
+	if (SDL_QueryTexture(texture, &format, NULL, &w, &h) != 0)
+		return 0;
+	int bpp = SDL_BYTESPERPIXEL(format);
+	return (size_t)w * (size_t)h * (size_t)(bpp ? bpp : 4);
+}
+
+static int find_entry(const texture_cache_t *cache, const char *key, uint32_t hash) {
+	for (int i = 0; i < cache->entry_count; ++i) {
+		const texture_entry_t *entry = &cache->entries[i];
+		if (entry->key && entry->hash == hash && strcmp(entry->key, key) == 0)
+			return i;
+	}
+	return TEXTURE_NONE;
+}
+
+static int free_slot(texture_cache_t *cache) {
+	for (int i = 0; i < cache->entry_count; ++i)
+		if (!cache->entries[i].key)
+			return i;
+
+	if (cache->entry_count == cache->entry_capacity) {
+		int capacity = cache->entry_capacity ? cache->entry_capacity * 2 : 16;
+		texture_entry_t *entries = realloc(cache->entries, sizeof(texture_entry_t) * capacity);
+		if (!entries) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to grow texture cache.\n");
+			return TEXTURE_NONE;
+		}
+		cache->entries = entries;
+		cache->entry_capacity = capacity;
+	}
+	cache->entries[cache->entry_count] = (texture_entry_t){0};
+	return cache->entry_count++;
+}
+
+static void evict(texture_cache_t *cache, int id) {
+	texture_entry_t *entry = &cache->entries[id];
+	SDL_Log("Evicting texture %s (%zu bytes)\n", entry->key, entry->bytes);
+	if (cache->on_evict)
+		cache->on_evict(cache->evict_userdata, id);
+	SDL_DestroyTexture(entry->texture);
+	free(entry->key);
+	cache->bytes -= entry->bytes;
+	*entry = (texture_entry_t){0};
+}
+
+bool texture_cache_init(texture_cache_t *cache, SDL_Renderer *renderer, size_t budget) {
+	*cache = (texture_cache_t){
+		.renderer = renderer,
+		.budget = budget,
+	};
+	return true;
+}
+
+void texture_cache_destroy(texture_cache_t *cache) {
+	for (int i = 0; i < cache->entry_count; ++i) {
+		texture_entry_t *entry = &cache->entries[i];
+		if (!entry->key)
+			continue;
+		if (entry->refs > 0)
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Texture %s destroyed with %d references left\n", entry->key, entry->refs);
+		evict(cache, i);
+	}
+	free(cache->entries);
+	*cache = (texture_cache_t){0};
+}
+
+int texture_cache_insert(texture_cache_t *cache, const char *key, SDL_Texture *texture) {
+	uint32_t hash = hash_key(key);
+	if (find_entry(cache, key, hash) != TEXTURE_NONE) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Texture %s is already cached\n", key);
+		return TEXTURE_NONE;
+	}
+
+	int id = free_slot(cache);
+	if (id == TEXTURE_NONE)
+		return TEXTURE_NONE;
+
+	char *key_copy = malloc(strlen(key) + 1);
+	if (!key_copy) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough memory to cache texture %s.\n", key);
+		return TEXTURE_NONE;
+	}
+	strcpy(key_copy, key);
+
+	cache->entries[id] = (texture_entry_t){
+		.key = key_copy,
+		.hash = hash,
+		.texture = texture,
+		.refs = 1,
+		.bytes = texture_bytes(texture),
+		.last_use = ++cache->tick,
+	};
+	cache->bytes += cache->entries[id].bytes;
+
+	// New texture may push unused ones over the budget
+	texture_cache_trim(cache);
+	return id;
+}
+
+int texture_cache_acquire(texture_cache_t *cache, const char *key) {
+	int id = find_entry(cache, key, hash_key(key));
+	if (id == TEXTURE_NONE)
+		return TEXTURE_NONE;
+	cache->entries[id].refs++;
+	cache->entries[id].last_use = ++cache->tick;
+	return id;
+}
+
+void texture_cache_release(texture_cache_t *cache, int id) {
+	if (id == TEXTURE_NONE)
+		return;
+	texture_entry_t *entry = &cache->entries[id];
+	if (entry->refs <= 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Texture %s released more times than acquired\n", entry->key);
+		return;
+	}
+	// Unused texture stays cached until the budget is exceeded
+	if (--entry->refs == 0)
+		texture_cache_trim(cache);
+}
+
+SDL_Texture *texture_cache_get(texture_cache_t *cache, int id) {
+	if (id == TEXTURE_NONE)
+		return NULL;
+	cache->entries[id].last_use = ++cache->tick;
+	return cache->entries[id].texture;
+}
+
+void texture_cache_trim(texture_cache_t *cache) {
+	while (cache->bytes > cache->budget) {
+		int victim = TEXTURE_NONE;
+		for (int i = 0; i < cache->entry_count; ++i) {
+			const texture_entry_t *entry = &cache->entries[i];
+			if (entry->key && entry->refs == 0 && (victim == TEXTURE_NONE || entry->last_use < cache->entries[victim].last_use))
+				victim = i;
+		}
+		// Everything left is in use
+		if (victim == TEXTURE_NONE)
+			return;
+		evict(cache, victim);
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <SDL.h>
+
+#define TEXTURE_NONE (-1)
+
+// Texture shared by every user of the same asset
+typedef struct {
+	char *key;							// Asset path (or any unique name), NULL when the slot is free
+	uint32_t hash;						// Hash of the key, checked before comparing strings
+	SDL_Texture *texture;
+	int refs;							// Number of users, entries with zero refs can be evicted
+	size_t bytes;						// Estimated size of the texture in graphics memory
+	uint64_t last_use;					// Tick of the last insert/acquire/get, used for LRU eviction
+} texture_entry_t;
+
+// Called with the id of a texture about to be destroyed, before the id can be given to another texture
+typedef void (*texture_evict_fn)(void *userdata, int id);
+
+typedef struct {
+	SDL_Renderer *renderer;
+	texture_entry_t *entries;			// Dynamic array of entries, indexed by texture id
+	int entry_count;
+	int entry_capacity;
+	size_t bytes;						// Estimated bytes of every cached texture
+	size_t budget;						// Unused textures are evicted above this amount
+	uint64_t tick;
+	texture_evict_fn on_evict;			// Optional, lets copies kept by id be dropped
+	void *evict_userdata;
+} texture_cache_t;
+
+bool texture_cache_init(texture_cache_t *cache, SDL_Renderer *renderer, size_t budget);
+void texture_cache_destroy(texture_cache_t *cache);
+
+// Id of the texture cached under the given key holding one more reference, TEXTURE_NONE on a miss:
+// the caller then creates the texture and adopts it with texture_cache_insert
+int texture_cache_acquire(texture_cache_t *cache, const char *key);
+// Adopts a texture created elsewhere under the given key, returns its id holding one reference
+int texture_cache_insert(texture_cache_t *cache, const char *key, SDL_Texture *texture);
+void texture_cache_release(texture_cache_t *cache, int id);
+
+// Returns the texture of an id and marks it as recently used
+SDL_Texture *texture_cache_get(texture_cache_t *cache, int id);
+
+// Evicts least recently used textures without references until the cache fits its budget
+void texture_cache_trim(texture_cache_t *cache);
+
+#endif // TEXTURE_CACHE_H
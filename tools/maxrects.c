@@ -0,0 +1,94 @@
+#include "maxrects.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+static bool push_free(maxrects_t *bin, SDL_Rect rect) {
+	if (bin->free_count == bin->free_capacity) {
+		int capacity = bin->free_capacity ? bin->free_capacity * 2 : 64;
+		SDL_Rect *free_rects = realloc(bin->free, sizeof(SDL_Rect) * capacity);
+		if (!free_rects)
+			return false;
+		bin->free = free_rects;
+		bin->free_capacity = capacity;
+	}
+	bin->free[bin->free_count++] = rect;
+	return true;
+}
+
+static bool contains(const SDL_Rect *outer, const SDL_Rect *inner) {
+	return inner->x >= outer->x && inner->y >= outer->y &&
+		   inner->x + inner->w <= outer->x + outer->w && inner->y + inner->h <= outer->y + outer->h;
+}
+
+// Replaces a free rect overlapped by the used one with what is left of it on each side
+static bool split(maxrects_t *bin, int index, const SDL_Rect *used) {
+	SDL_Rect rect = bin->free[index];
+	if (!SDL_HasIntersection(&rect, used))
+		return true;
+
+	bin->free[index] = bin->free[--bin->free_count];
+	bool ok = true;
+	if (used->x > rect.x)
+		ok &= push_free(bin, (SDL_Rect){rect.x, rect.y, used->x - rect.x, rect.h});
+	if (used->x + used->w < rect.x + rect.w)
+		ok &= push_free(bin, (SDL_Rect){used->x + used->w, rect.y, rect.x + rect.w - used->x - used->w, rect.h});
+	if (used->y > rect.y)
+		ok &= push_free(bin, (SDL_Rect){rect.x, rect.y, rect.w, used->y - rect.y});
+	if (used->y + used->h < rect.y + rect.h)
+		ok &= push_free(bin, (SDL_Rect){rect.x, used->y + used->h, rect.w, rect.y + rect.h - used->y - used->h});
+	return ok;
+}
+
+// Drops free rects that are inside another one
+static void prune(maxrects_t *bin) {
+	for (int i = 0; i < bin->free_count; ++i) {
+		for (int j = i + 1; j < bin->free_count; ++j) {
+			if (contains(&bin->free[j], &bin->free[i])) {
+				bin->free[i--] = bin->free[--bin->free_count];
+				break;
+			}
+			if (contains(&bin->free[i], &bin->free[j]))
+				bin->free[j--] = bin->free[--bin->free_count];
+		}
+	}
+}
+
+bool maxrects_init(maxrects_t *bin, int w, int h) {
+	*bin = (maxrects_t){.w = w, .h = h};
+	return push_free(bin, (SDL_Rect){0, 0, w, h});
+}
+
+void maxrects_destroy(maxrects_t *bin) {
+	free(bin->free);
+	*bin = (maxrects_t){0};
+}
+
+bool maxrects_insert(maxrects_t *bin, int w, int h, SDL_Rect *placed) {
+	int best = -1, best_short = INT_MAX, best_long = INT_MAX;
+
+	for (int i = 0; i < bin->free_count; ++i) {
+		const SDL_Rect *rect = &bin->free[i];
+		if (w > rect->w || h > rect->h)
+			continue;
+		int left_w = rect->w - w, left_h = rect->h - h;
+		int short_side = SDL_min(left_w, left_h), long_side = SDL_max(left_w, left_h);
+		if (short_side < best_short || (short_side == best_short && long_side < best_long)) {
+			best = i;
+			best_short = short_side;
+			best_long = long_side;
+		}
+	}
+	if (best < 0)
+		return false;
+
+	*placed = (SDL_Rect){bin->free[best].x, bin->free[best].y, w, h};
+
+	// Rects appended by split are outside the used one, no need to visit them
+	int count = bin->free_count;
+	for (int i = count - 1; i >= 0; --i)
+		if (!split(bin, i, placed))
+			return false;
+	prune(bin);
+	return true;
+}
@@ -0,0 +1,22 @@
+#ifndef MAXRECTS_H
+#define MAXRECTS_H
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+// MaxRects bin packer: keeps every maximal free rectangle of the bin
+typedef struct {
+	int w, h;
+	SDL_Rect *free;						// Maximal free rectangles, they may overlap
+	int free_count;
+	int free_capacity;
+} maxrects_t;
+
+bool maxrects_init(maxrects_t *bin, int w, int h);
+void maxrects_destroy(maxrects_t *bin);
+
+// Places a rect with the best short side fit heuristic, returns false when it does not fit
+bool maxrects_insert(maxrects_t *bin, int w, int h, SDL_Rect *placed);
+
+#endif // MAXRECTS_H
@@ -0,0 +1,268 @@
+// Packs sprite sheets into a pre-decoded .spk file: every frame is trimmed to its
+// visible pixels and the trimmed frames are packed with MaxRects
+// Usage: spkpack [-f FORMAT] [-g COLSxROWS] output.spk sheet.png...
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include "../spritepack.h"
+#include "maxrects.h"
+
+#define MAX_SHEETS 256
+#define MAX_SIZE 8192					// Largest texture side accepted by common renderers
+#define PADDING 1						// Gap between frames so filtering never reads a neighbour
+
+static const uint32_t formats[] = {
+	SDL_PIXELFORMAT_ARGB8888,
+	SDL_PIXELFORMAT_ABGR8888,
+	SDL_PIXELFORMAT_RGBA8888,
+	SDL_PIXELFORMAT_BGRA8888,
+};
+
+static uint32_t align(uint32_t offset) {
+	return (offset + SPK_ALIGN - 1) & ~(uint32_t)(SPK_ALIGN - 1);
+}
+
+static bool parse_format(const char *name, uint32_t *format) {
+	for (size_t i = 0; i < SDL_arraysize(formats); ++i) {
+		// Accept both "ARGB8888" and "SDL_PIXELFORMAT_ARGB8888"
+		const char *full = SDL_GetPixelFormatName(formats[i]);
+		if (strcmp(full, name) == 0 || strcmp(full + strlen("SDL_PIXELFORMAT_"), name) == 0) {
+			*format = formats[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+static void sheet_name(char name[SPK_NAME_SIZE], const char *path) {
+	const char *base = path;
+	for (const char *c = path; *c; ++c)
+		if (*c == '/' || *c == '\\')
+			base = c + 1;
+	size_t len = strcspn(base, ".");
+	if (len >= SPK_NAME_SIZE)
+		len = SPK_NAME_SIZE - 1;
+	memset(name, 0, SPK_NAME_SIZE);
+	memcpy(name, base, len);
+}
+
+// Shrinks a frame to the bounding box of its non-transparent pixels
+static SDL_Rect trim(const SDL_Surface *surface, SDL_Rect frame) {
+	int min_x = frame.x + frame.w, min_y = frame.y + frame.h, max_x = frame.x - 1, max_y = frame.y - 1;
+	int bpp = surface->format->BytesPerPixel;
+
+	for (int y = frame.y; y < frame.y + frame.h; ++y) {
+		const uint8_t *row = (const uint8_t *)surface->pixels + (size_t)y * surface->pitch;
+		for (int x = frame.x; x < frame.x + frame.w; ++x) {
+			uint32_t pixel;
+			memcpy(&pixel, row + (size_t)x * bpp, sizeof(pixel));
+			if (!(pixel & surface->format->Amask))
+				continue;
+			min_x = SDL_min(min_x, x);
+			max_x = SDL_max(max_x, x);
+			min_y = SDL_min(min_y, y);
+			max_y = SDL_max(max_y, y);
+		}
+	}
+	if (max_x < min_x)
+		return (SDL_Rect){frame.x, frame.y, 0, 0};
+	return (SDL_Rect){min_x, min_y, max_x - min_x + 1, max_y - min_y + 1};
+}
+
+typedef struct {
+	int frame;							// Index in the frame table
+	SDL_Rect trimmed;					// Visible pixels in the source sheet
+} pack_item_t;
+
+static int compare_items(const void *a, const void *b) {
+	// Biggest first, MaxRects fills the gaps with the small ones
+	const SDL_Rect *ra = &((const pack_item_t *)a)->trimmed, *rb = &((const pack_item_t *)b)->trimmed;
+	int side_a = SDL_max(ra->w, ra->h), side_b = SDL_max(rb->w, rb->h);
+	if (side_a != side_b)
+		return side_b - side_a;
+	return rb->w * rb->h - ra->w * ra->h;
+}
+
+// Finds the smallest power of two bin holding every item, growing the shorter side first
+static bool pack(pack_item_t *items, int count, SDL_Rect *placed, int *bin_w, int *bin_h) {
+	long long area = 0;
+	for (int i = 0; i < count; ++i)
+		area += (long long)(items[i].trimmed.w + PADDING) * (items[i].trimmed.h + PADDING);
+
+	int w = 64, h = 64;
+	while ((long long)w * h < area)
+		w <= h ? (w *= 2) : (h *= 2);
+
+	for (; w <= MAX_SIZE && h <= MAX_SIZE; w <= h ? (w *= 2) : (h *= 2)) {
+		maxrects_t bin;
+		if (!maxrects_init(&bin, w, h))
+			return false;
+		int i = 0;
+		for (; i < count; ++i)
+			if (!maxrects_insert(&bin, items[i].trimmed.w + PADDING, items[i].trimmed.h + PADDING, &placed[i]))
+				break;
+		maxrects_destroy(&bin);
+		if (i == count) {
+			*bin_w = w;
+			*bin_h = h;
+			return true;
+		}
+	}
+	return false;
+}
+
+static int usage(void) {
+	fprintf(stderr, "Usage: spkpack [-f ARGB8888|ABGR8888|RGBA8888|BGRA8888] [-g COLSxROWS] output.spk sheet.png...\n");
+	return EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+	uint32_t format = SDL_PIXELFORMAT_ARGB8888;	// Preferred format of most renderers
+	int cols = 4, rows = 13;					// Frame grid of the sheets
+	int arg = 1;
+
+	for (; arg < argc && argv[arg][0] == '-'; arg += 2) {
+		if (arg + 1 >= argc)
+			return usage();
+		if (strcmp(argv[arg], "-f") == 0) {
+			if (!parse_format(argv[arg + 1], &format))
+				return usage();
+		} else if (strcmp(argv[arg], "-g") == 0) {
+			if (sscanf(argv[arg + 1], "%dx%d", &cols, &rows) != 2 || cols <= 0 || rows <= 0)
+				return usage();
+		} else {
+			return usage();
+		}
+	}
+	if (argc - arg < 2 || argc - arg - 1 > MAX_SHEETS)
+		return usage();
+
+	const char *output = argv[arg++];
+	int sheet_count = argc - arg;
+	int frame_count = sheet_count * cols * rows;
+	SDL_Surface *surfaces[MAX_SHEETS] = {0};
+	spk_sheet_t sheets[MAX_SHEETS] = {0};
+	pack_item_t *items = calloc((size_t)frame_count, sizeof(pack_item_t));
+	SDL_Rect *placed = calloc((size_t)frame_count, sizeof(SDL_Rect));
+	spk_frame_t *frames = calloc((size_t)frame_count, sizeof(spk_frame_t));
+	if (!items || !placed || !frames) {
+		fprintf(stderr, "Not enough memory for %d frames\n", frame_count);
+		return EXIT_FAILURE;
+	}
+
+	// Decode, convert and trim once here, so the game never does
+	int item_count = 0;
+	long long full_pixels = 0, trimmed_pixels = 0;
+	for (int i = 0; i < sheet_count; ++i) {
+		SDL_Surface *decoded = IMG_Load(argv[arg + i]);
+		if (!decoded) {
+			fprintf(stderr, "Could not load %s: %s\n", argv[arg + i], IMG_GetError());
+			return EXIT_FAILURE;
+		}
+		surfaces[i] = SDL_ConvertSurfaceFormat(decoded, format, 0);
+		SDL_FreeSurface(decoded);
+		if (!surfaces[i]) {
+			fprintf(stderr, "Could not convert %s: %s\n", argv[arg + i], SDL_GetError());
+			return EXIT_FAILURE;
+		}
+
+		int frame_w = surfaces[i]->w / cols, frame_h = surfaces[i]->h / rows;
+		if (frame_w <= 0 || frame_h <= 0 || frame_w > UINT16_MAX || frame_h > UINT16_MAX) {
+			fprintf(stderr, "%s does not fit a %dx%d grid\n", argv[arg + i], cols, rows);
+			return EXIT_FAILURE;
+		}
+		sheet_name(sheets[i].name, argv[arg + i]);
+		sheets[i].w = (uint32_t)surfaces[i]->w;
+		sheets[i].h = (uint32_t)surfaces[i]->h;
+		sheets[i].frame_w = (uint32_t)frame_w;
+		sheets[i].frame_h = (uint32_t)frame_h;
+		sheets[i].first_frame = (uint32_t)(i * cols * rows);
+		sheets[i].frame_count = (uint32_t)(cols * rows);
+
+		for (int frame = 0; frame < cols * rows; ++frame) {
+			SDL_Rect cell = {frame % cols * frame_w, frame / cols * frame_h, frame_w, frame_h};
+			SDL_Rect trimmed = trim(surfaces[i], cell);
+			int index = (int)sheets[i].first_frame + frame;
+			frames[index].offset_x = (int16_t)(trimmed.x - cell.x);
+			frames[index].offset_y = (int16_t)(trimmed.y - cell.y);
+			full_pixels += (long long)frame_w * frame_h;
+			trimmed_pixels += (long long)trimmed.w * trimmed.h;
+			// Transparent frames keep an empty rect and take no room
+			if (trimmed.w > 0)
+				items[item_count++] = (pack_item_t){index, trimmed};
+		}
+	}
+
+	qsort(items, (size_t)item_count, sizeof(pack_item_t), compare_items);
+	int bin_w, bin_h;
+	if (!pack(items, item_count, placed, &bin_w, &bin_h)) {
+		fprintf(stderr, "Frames do not fit in a %dx%d texture\n", MAX_SIZE, MAX_SIZE);
+		return EXIT_FAILURE;
+	}
+
+	spk_header_t header = {
+		.magic = SPK_MAGIC,
+		.version = SPK_VERSION,
+		.pixel_format = format,
+		.width = (uint32_t)bin_w,
+		.height = (uint32_t)bin_h,
+		.pitch = (uint32_t)bin_w * SDL_BYTESPERPIXEL(format),
+		.sheet_count = (uint32_t)sheet_count,
+		.frame_count = (uint32_t)frame_count,
+	};
+	header.sheet_offset = align(sizeof(spk_header_t));
+	header.frame_offset = align(header.sheet_offset + header.sheet_count * sizeof(spk_sheet_t));
+	header.pixel_offset = align(header.frame_offset + header.frame_count * sizeof(spk_frame_t));
+
+	size_t size = header.pixel_offset + (size_t)header.pitch * header.height;
+	uint8_t *data = calloc(1, size);
+	if (!data) {
+		fprintf(stderr, "Not enough memory for %zu bytes\n", size);
+		return EXIT_FAILURE;
+	}
+
+	// Copy the visible pixels of every frame to its place in the bin
+	uint8_t *pixels = data + header.pixel_offset;
+	int bpp = SDL_BYTESPERPIXEL(format);
+	for (int i = 0; i < item_count; ++i) {
+		spk_frame_t *frame = &frames[items[i].frame];
+		const SDL_Surface *surface = surfaces[items[i].frame / (cols * rows)];
+		const SDL_Rect *src = &items[i].trimmed;
+		frame->x = (uint16_t)placed[i].x;
+		frame->y = (uint16_t)placed[i].y;
+		frame->w = (uint16_t)src->w;
+		frame->h = (uint16_t)src->h;
+		for (int y = 0; y < src->h; ++y) {
+			memcpy(pixels + (size_t)(frame->y + y) * header.pitch + (size_t)frame->x * bpp,
+				   (const uint8_t *)surface->pixels + (size_t)(src->y + y) * surface->pitch + (size_t)src->x * bpp,
+				   (size_t)src->w * bpp);
+		}
+	}
+	for (int i = 0; i < sheet_count; ++i)
+		SDL_FreeSurface(surfaces[i]);
+
+	memcpy(data, &header, sizeof(header));
+	memcpy(data + header.sheet_offset, sheets, sheet_count * sizeof(spk_sheet_t));
+	memcpy(data + header.frame_offset, frames, frame_count * sizeof(spk_frame_t));
+
+	FILE *file = fopen(output, "wb");
+	if (!file || fwrite(data, 1, size, file) != size) {
+		fprintf(stderr, "Could not write %s\n", output);
+		if (file)
+			fclose(file);
+		return EXIT_FAILURE;
+	}
+	fclose(file);
+	free(data);
+	free(frames);
+	free(placed);
+	free(items);
+
+	printf("Packed %d frames of %d sheets into %s (%dx%d, %s)\n", item_count, sheet_count, output, bin_w, bin_h, SDL_GetPixelFormatName(format));
+	printf("Trimming keeps %lld of %lld pixels (%.1f%%)\n", trimmed_pixels, full_pixels, full_pixels ? 100.0 * trimmed_pixels / full_pixels : 0.0);
+	return EXIT_SUCCESS;
+}